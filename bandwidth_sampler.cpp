@@ -1,4 +1,8 @@
 #include <bandwidth_sampler.h>
+#include <cmath>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace bbr
 {
@@ -39,6 +43,40 @@ BandwidthSampler::BandwidthSampler(int ack_track_win)
     max_ack_height_tracker_.set_threshold(2.0);
 }
 
+void BandwidthSampler::reset()
+{
+    last_sent_packet_ = std::numeric_limits<uint64_t>::max();
+    epoch_ = time::Timestamp();
+    last_sent_time_ = time::Timestamp();
+
+    total_bytes_sent_ = 0;
+    total_bytes_acked_ = 0;
+    total_bytes_lost_ = 0;
+    total_bytes_neutered_ = 0;
+    total_bytes_sent_at_last_acked_packet_ = 0;
+    last_acked_packet_sent_time_ = time::Timestamp();
+    last_acked_packet_ack_time_ = time::Timestamp();
+
+    is_app_limited_ = false;
+    end_of_app_limited_phase_ = std::numeric_limits<uint64_t>::max();
+
+    own_pkts_.clear();
+    acked_samples_.clear();
+    ack_points_.clear();
+    a0_candidates_.clear();
+    receive_points_.clear();
+    max_ack_height_tracker_.clear();
+    total_bytes_acked_after_last_ack_event_ = 0;
+}
+
+void BandwidthSampler::release_memory()
+{
+    own_pkts_.release();
+    acked_samples_ = AckedSamples();
+    a0_candidates_.shrink_to_fit();
+    receive_points_.shrink_to_fit();
+}
+
 void BandwidthSampler::on_packet_sent(uint64_t seq_no, size_t bytes,
         size_t bytes_in_flight, time::Timestamp at_time, bool need_retransmite)
 {
@@ -62,25 +100,31 @@ void BandwidthSampler::on_packet_sent(uint64_t seq_no, size_t bytes,
 
         a0_candidates_.clear();
         a0_candidates_.push_back(ack_points_.recent_point());
+        // The peer was idle too.
+        receive_points_.clear();
     }
 
-    SendTimeState cur_state {
-        false,  //invalid
-        is_app_limited_,
-        total_bytes_sent_,
-        total_bytes_acked_,
-        total_bytes_lost_,
-        bytes + bytes_in_flight};
-
-    state_map_.insert(std::make_pair(seq_no,
-            ConnectionStateOnSentPacket{
-                bytes,
-                at_time,
-                total_bytes_sent_at_last_acked_packet_,
-                last_acked_packet_sent_time_,
-                last_acked_packet_ack_time_,
-                cur_state}));
-    //TODO: warn when state_map_ contain too much tracked packet
+    if (!epoch_.is_valid()) {
+        epoch_ = at_time;
+    }
+    last_sent_time_ = at_time;
+
+    ConnectionStateOnSentPacket state;
+    state.is_app_limited = is_app_limited_;
+    state.last_acked_pkt_sent_gap_us = time_gap(last_acked_packet_sent_time_, at_time);
+    state.last_acked_pkt_ack_gap_us = time_gap(last_acked_packet_ack_time_, at_time);
+    state.sent_time_us = static_cast<uint32_t>(at_time.microseconds() -
+            epoch_.microseconds());
+    state.total_bytes_sent = static_cast<uint32_t>(total_bytes_sent_);
+    state.total_bytes_acked = static_cast<uint32_t>(total_bytes_acked_);
+    state.total_bytes_lost = static_cast<uint32_t>(total_bytes_lost_);
+    state.bytes_in_flight = static_cast<uint32_t>(bytes + bytes_in_flight);
+    state.bytes_sent_since_last_acked_pkt = static_cast<uint32_t>(
+            total_bytes_sent_ - total_bytes_sent_at_last_acked_packet_);
+
+    SentPacketTable& sent_pkts = this->sent_pkts();
+    sent_pkts.set_sampler_state(sent_pkts.insert(seq_no, bytes, at_time), state);
+    //TODO: warn when sent_pkts contain too much tracked packet
 }
 
 CongestionEventSample BandwidthSampler::on_congestion_event(time::Timestamp ack_time,
@@ -108,27 +152,35 @@ CongestionEventSample BandwidthSampler::on_congestion_event(time::Timestamp ack_
     }
 
     SendTimeState last_acked_packet_send_state;
+    acked_samples_.clear();
     for (const auto& pkt : acked_pkts) {
-        BandwidthSample sample =  on_pkt_acked( pkt.seq_no, ack_time);
-        if (!sample.state_at_send.is_valid) {
-            continue;
+        SendTimeState send_state = on_pkt_acked(pkt.seq_no, ack_time,
+                pkt.receive_time);
+        if (send_state.is_valid) {
+            last_acked_packet_send_state = send_state;
         }
+    }
 
-        last_acked_packet_send_state = sample.state_at_send;
+    if (acked_samples_.size() > 0) {
+        event_sample.sample_count = acked_samples_.size();
+        SampleReduction reduction = reduce_acked_samples(acked_samples_);
         //get minimum rtt
-        if (sample.rtt.is_valid()) {
-            event_sample.sample_rtt = std::min(event_sample.sample_rtt, sample.rtt);
-        }
-        //get maximum bandwidth
-        if (sample.bandwidth.is_valid() &&
-                sample.bandwidth > event_sample.sample_max_bandwidth) {
-            event_sample.sample_max_bandwidth = sample.bandwidth;
-            event_sample.sample_is_app_limited = sample.state_at_send.is_app_limited;
+        event_sample.sample_rtt = std::min(event_sample.sample_rtt,
+                time::TimeDelta(reduction.min_rtt_us));
+        //get maximum bandwidth, the first one if several packets have it
+        common::BandWidth max_bandwidth(
+                acked_samples_.bandwidth[reduction.max_bandwidth_index]);
+        if (max_bandwidth > event_sample.sample_max_bandwidth) {
+            event_sample.sample_max_bandwidth = max_bandwidth;
+            event_sample.sample_is_app_limited =
+                    acked_samples_.is_app_limited[reduction.max_bandwidth_index];
         }
         //get maximum inflight
-        size_t inflight_sample = total_bytes_acked_ - last_acked_packet_send_state.total_bytes_acked;
-        if (inflight_sample > event_sample.sample_max_inflight) {
-            event_sample.sample_max_inflight = inflight_sample;
+        event_sample.sample_max_inflight = std::max(
+                event_sample.sample_max_inflight,
+                static_cast<size_t>(reduction.max_inflight));
+        if (histograms_) {
+            record_samples();
         }
     }
 
@@ -154,6 +206,9 @@ CongestionEventSample BandwidthSampler::on_congestion_event(time::Timestamp ack_
     max_bw = std::min(max_bw, estimated_bw_upper_bound);
 
     event_sample.extra_acked = extra_acked(max_bw, round_count);
+    if (histograms_) {
+        histograms_->extra_acked_bytes.record(event_sample.extra_acked);
+    }
 
     return event_sample;
 }
@@ -163,30 +218,43 @@ SendTimeState BandwidthSampler::on_pkt_lost(uint64_t seq_no, size_t bytes)
     SendTimeState state;
 
     total_bytes_lost_ += bytes;
-    auto iter = state_map_.find(seq_no);
-    if(iter != state_map_.end())
+    const SentPacketTable& sent_pkts = this->sent_pkts();
+    size_t slot = sent_pkts.find(seq_no);
+    if(slot != SentPacketTable::npos && sent_pkts.has_sampler_state(slot))
     {
-        connection_state_to_sent_state(iter->second, state);
+        connection_state_to_sent_state(sent_pkts.sampler_state(slot), state);
     }
     return state;
 }
 
-BandwidthSample BandwidthSampler::on_pkt_acked(uint64_t seq_no, time::Timestamp ack_time)
+SendTimeState BandwidthSampler::on_pkt_acked(uint64_t seq_no,
+        time::Timestamp ack_time, time::Timestamp receive_time)
 {
-    BandwidthSample sample;
-    auto iter = state_map_.find(seq_no);
-    if(iter ==  state_map_.end()) {
-        return sample;
+    const SentPacketTable& sent_pkts = this->sent_pkts();
+    size_t slot = sent_pkts.find(seq_no);
+    if(slot == SentPacketTable::npos || !sent_pkts.has_sampler_state(slot)) {
+        return SendTimeState();
     }
-    ConnectionStateOnSentPacket& sent_pkt = iter->second;
-
-    total_bytes_acked_ += sent_pkt.bytes;
-    total_bytes_sent_at_last_acked_packet_ = sent_pkt.state.total_bytes_sent;
-    last_acked_packet_sent_time_ = sent_pkt.sent_time;
+    const ConnectionStateOnSentPacket sent_pkt = sent_pkts.sampler_state(slot);
+    SendTimeState state_at_send;
+    connection_state_to_sent_state(sent_pkt, state_at_send);
+    time::Timestamp sent_time = this->sent_time(sent_pkt);
+
+    total_bytes_acked_ += sent_pkts.bytes(slot);
+    total_bytes_sent_at_last_acked_packet_ = state_at_send.total_bytes_sent;
+    last_acked_packet_sent_time_ = sent_time;
     last_acked_packet_ack_time_ = ack_time;
 
     ack_points_.update(ack_time, total_bytes_acked_);
 
+    size_t receive_bytes = 0;
+    int64_t receive_us = 0;
+    bool has_receive_rate = use_receive_times_ && receive_rate(
+            state_at_send.total_bytes_acked, receive_time, receive_bytes, receive_us);
+    if (use_receive_times_ && receive_time.is_valid()) {
+        receive_points_.push_back({total_bytes_acked_, receive_time});
+    }
+
     if(is_app_limited_) {
         // Exit app-limited phase in two cases:
         // (1) end_of_app_limited_phase_ is not initialized, i.e., so far all
@@ -202,27 +270,62 @@ BandwidthSample BandwidthSampler::on_pkt_acked(uint64_t seq_no, time::Timestamp
     // There might have been no packets acknowledged at the moment when the
     // current packet was sent. In that case, there is no bandwidth sample to
     // make.
-    if(!sent_pkt.last_acked_pkt_sent_time.is_valid()) {
-        return sample;
+    if(sent_pkt.last_acked_pkt_sent_gap_us == ConnectionStateOnSentPacket::kInvalidTimeGap ||
+            sent_pkt.last_acked_pkt_ack_gap_us == ConnectionStateOnSentPacket::kInvalidTimeGap) {
+        return SendTimeState();
     }
-    common::BitRate send_rate;
-    if (sent_pkt.sent_time > sent_pkt.last_acked_pkt_sent_time) {
-        send_rate =  (sent_pkt.state.total_bytes_sent - sent_pkt.total_sent_bytes_at_last_acked_pkt) /
-              (sent_pkt.sent_time - sent_pkt.last_acked_pkt_sent_time);
+    AckedSamples& samples = acked_samples_;
+    if (sent_pkt.last_acked_pkt_sent_gap_us > 0) {
+        samples.send_bytes.push_back(sent_pkt.bytes_sent_since_last_acked_pkt);
+        samples.send_us.push_back(sent_pkt.last_acked_pkt_sent_gap_us);
+    } else {
+        // No send rate, the sample is bounded by the ack rate only.
+        samples.send_bytes.push_back(std::numeric_limits<double>::infinity());
+        samples.send_us.push_back(1);
     }
     AckPoint a0;
-    if(!choose_a0(sent_pkt.state.total_bytes_acked, a0)) {
-        a0.ack_time = sent_pkt.last_acked_pkt_ack_time;
-        a0.total_bytes_acked = sent_pkt.state.total_bytes_acked;
+    if(!choose_a0(state_at_send.total_bytes_acked, a0)) {
+        a0.ack_time = time::Timestamp(sent_time.microseconds() -
+                sent_pkt.last_acked_pkt_ack_gap_us);
+        a0.total_bytes_acked = state_at_send.total_bytes_acked;
     }
     assert(a0.ack_time < ack_time);
-    common::BitRate ack_rate = (total_bytes_acked_ - a0.total_bytes_acked) / (ack_time - a0.ack_time);
+    if (has_receive_rate) {
+        samples.ack_bytes.push_back(receive_bytes);
+        samples.ack_us.push_back(receive_us);
+    } else {
+        samples.ack_bytes.push_back(total_bytes_acked_ - a0.total_bytes_acked);
+        samples.ack_us.push_back((ack_time - a0.ack_time).value());
+    }
 
-    sample.bandwidth = std::min(send_rate, ack_rate);
-    sample.rtt = ack_time - sent_pkt.sent_time;
-    connection_state_to_sent_state(sent_pkt, sample.state_at_send);
+    samples.rtt_us.push_back((ack_time - sent_time).value());
+    samples.inflight.push_back(total_bytes_acked_ - state_at_send.total_bytes_acked);
+    samples.is_app_limited.push_back(state_at_send.is_app_limited);
 
-    return sample;
+    return state_at_send;
+}
+
+bool BandwidthSampler::receive_rate(size_t total_bytes_acked_at_send,
+        time::Timestamp receive_time, size_t& bytes, int64_t& us)
+{
+    // Later packets were sent after this one, with at least as many bytes
+    // acked.
+    while (!receive_points_.empty() &&
+            receive_points_.front().total_bytes_acked < total_bytes_acked_at_send) {
+        receive_points_.pop_front();
+    }
+    if (!receive_time.is_valid() || receive_points_.empty() ||
+            receive_points_.front().total_bytes_acked != total_bytes_acked_at_send) {
+        return false;
+    }
+    const ReceivePoint& point = receive_points_.front();
+    if (receive_time <= point.receive_time) {
+        // Reordered, or received in the same instant.
+        return false;
+    }
+    bytes = total_bytes_acked_ - point.total_bytes_acked;
+    us = (receive_time - point.receive_time).value();
+    return true;
 }
 
 size_t BandwidthSampler::extra_acked(common::BandWidth max_bw, int round_count)
@@ -272,20 +375,18 @@ bool BandwidthSampler::choose_a0(size_t total_bytes_acked, AckPoint& point)
 
 void BandwidthSampler::on_pkt_neutered(uint64_t seq_no)
 {
-    auto iter = state_map_.find(seq_no);
-    if(iter == state_map_.end()) {
+    SentPacketTable& sent_pkts = this->sent_pkts();
+    size_t slot = sent_pkts.find(seq_no);
+    if(slot == SentPacketTable::npos || !sent_pkts.has_sampler_state(slot)) {
         return;
     }
-    total_bytes_neutered_ += iter->second.bytes;
-    state_map_.erase(iter);
+    total_bytes_neutered_ += sent_pkts.bytes(slot);
+    sent_pkts.erase(seq_no);
 }
 //[0, up_to)
 void BandwidthSampler::remove_obsolete_pkts(uint64_t up_to)
 {
-    auto iter = state_map_.lower_bound(up_to);
-    if(iter != state_map_.end()) {
-        state_map_.erase(state_map_.begin(), iter);
-    }
+    sent_pkts().erase_before(up_to);
 }
 
 void BandwidthSampler::on_app_limited()
@@ -299,10 +400,187 @@ bool BandwidthSampler::is_app_limited()
     return is_app_limited_;
 }
 
+void BandwidthSampler::record_samples()
+{
+    for (size_t i = 0; i < acked_samples_.size(); i++) {
+        if (acked_samples_.rtt_us[i] >= 0) {
+            histograms_->rtt_us.record(
+                    static_cast<uint64_t>(acked_samples_.rtt_us[i]));
+        }
+        histograms_->bandwidth_bps.record(
+                static_cast<uint64_t>(acked_samples_.bandwidth[i]));
+    }
+}
+
+namespace
+{
+// Corrects the floating point quotient |approx| to the exact (truncated)
+// 'bytes / us' in bits per second, the result of 'size_t / TimeDelta'.
+// |approx| is off by at most one, so this usually takes two multiplications.
+int64_t exact_rate(double approx, double bytes, double us)
+{
+    if (std::isinf(approx)) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    const __int128 bits = static_cast<__int128>(bytes) * 8 * 1000 * 1000;
+    const __int128 den = static_cast<__int128>(us);
+    int64_t rate = static_cast<int64_t>(approx);
+    while (rate > 0 && rate * den > bits) {
+        rate--;
+    }
+    while ((rate + 1) * den <= bits) {
+        rate++;
+    }
+    return rate;
+}
+}
+
+// The divisions are done in floating point (four at a time with AVX2), the
+// results are then corrected with integer multiplications so that both paths
+// give exactly 'size_t / TimeDelta'.
+BandwidthSampler::SampleReduction BandwidthSampler::reduce_acked_samples(
+        AckedSamples& samples)
+{
+    const size_t n = samples.size();
+    assert(n > 0);
+    samples.send_rate.resize(n);
+    samples.ack_rate.resize(n);
+    samples.bandwidth.resize(n);
+
+    const int64_t* rtt_us = samples.rtt_us.data();
+    const int64_t* inflight = samples.inflight.data();
+    const double* send_bytes = samples.send_bytes.data();
+    const double* send_us = samples.send_us.data();
+    const double* ack_bytes = samples.ack_bytes.data();
+    const double* ack_us = samples.ack_us.data();
+    double* send_rate = samples.send_rate.data();
+    double* ack_rate = samples.ack_rate.data();
+
+    int64_t min_rtt_us = rtt_us[0];
+    int64_t max_inflight = inflight[0];
+    size_t i = 0;
+#if defined(__AVX2__)
+    if (n >= 4) {
+        const __m256d kBitsPerByteUs = _mm256_set1_pd(8 * 1000 * 1000);
+        __m256i min_rtt = _mm256_set1_epi64x(min_rtt_us);
+        __m256i max_infl = _mm256_set1_epi64x(max_inflight);
+        for (; i + 4 <= n; i += 4) {
+            __m256i rtt = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(rtt_us + i));
+            min_rtt = _mm256_blendv_epi8(min_rtt, rtt,
+                    _mm256_cmpgt_epi64(min_rtt, rtt));
+            __m256i infl = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(inflight + i));
+            max_infl = _mm256_blendv_epi8(max_infl, infl,
+                    _mm256_cmpgt_epi64(infl, max_infl));
+
+            _mm256_storeu_pd(send_rate + i, _mm256_div_pd(
+                    _mm256_mul_pd(_mm256_loadu_pd(send_bytes + i), kBitsPerByteUs),
+                    _mm256_loadu_pd(send_us + i)));
+            _mm256_storeu_pd(ack_rate + i, _mm256_div_pd(
+                    _mm256_mul_pd(_mm256_loadu_pd(ack_bytes + i), kBitsPerByteUs),
+                    _mm256_loadu_pd(ack_us + i)));
+        }
+        alignas(32) int64_t rtts[4];
+        alignas(32) int64_t infls[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(rtts), min_rtt);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(infls), max_infl);
+        for (int lane = 0; lane < 4; lane++) {
+            min_rtt_us = std::min(min_rtt_us, rtts[lane]);
+            max_inflight = std::max(max_inflight, infls[lane]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        min_rtt_us = std::min(min_rtt_us, rtt_us[i]);
+        max_inflight = std::max(max_inflight, inflight[i]);
+        send_rate[i] = send_bytes[i] * (8 * 1000 * 1000) / send_us[i];
+        ack_rate[i] = ack_bytes[i] * (8 * 1000 * 1000) / ack_us[i];
+    }
+
+    // The first packet with the maximum bandwidth.
+    size_t max_bandwidth_index = 0;
+    int64_t* bandwidth = samples.bandwidth.data();
+    for (i = 0; i < n; i++) {
+        bandwidth[i] = std::min(
+                exact_rate(send_rate[i], send_bytes[i], send_us[i]),
+                exact_rate(ack_rate[i], ack_bytes[i], ack_us[i]));
+        if (bandwidth[i] > bandwidth[max_bandwidth_index]) {
+            max_bandwidth_index = i;
+        }
+    }
+    return SampleReduction{min_rtt_us, max_inflight, max_bandwidth_index};
+}
+
+void BandwidthSampler::AckedSamples::clear()
+{
+    if (rtt_us.capacity() > kMaxRetainedSamples) {
+        *this = AckedSamples();
+        return;
+    }
+    rtt_us.clear();
+    inflight.clear();
+    send_bytes.clear();
+    send_us.clear();
+    ack_bytes.clear();
+    ack_us.clear();
+    is_app_limited.clear();
+    send_rate.clear();
+    ack_rate.clear();
+    bandwidth.clear();
+}
+
+namespace
+{
+// Restores a counter from its low 32 bits, |current| is never smaller than
+// the value being restored.
+size_t restore_counter(size_t current, uint32_t low_bits)
+{
+    return current - static_cast<uint32_t>(static_cast<uint32_t>(current) - low_bits);
+}
+}
+
 void BandwidthSampler::connection_state_to_sent_state(
         const ConnectionStateOnSentPacket& s1, SendTimeState& s2)
 {
-    s2 = s1.state;
     s2.is_valid = true;
+    s2.is_app_limited = s1.is_app_limited;
+    s2.total_bytes_sent = restore_counter(total_bytes_sent_, s1.total_bytes_sent);
+    s2.total_bytes_acked = restore_counter(total_bytes_acked_, s1.total_bytes_acked);
+    s2.total_bytes_lost = restore_counter(total_bytes_lost_, s1.total_bytes_lost);
+    s2.bytes_in_flight = s1.bytes_in_flight;
+}
+
+uint32_t BandwidthSampler::time_gap(time::Timestamp from, time::Timestamp to)
+{
+    if (!from.is_valid()) {
+        return ConnectionStateOnSentPacket::kInvalidTimeGap;
+    }
+    int64_t gap = to.microseconds() - from.microseconds();
+    if (gap < 0) {
+        // Time went backwards.
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min<int64_t>(gap,
+            ConnectionStateOnSentPacket::kInvalidTimeGap));
+}
+
+time::Timestamp BandwidthSampler::sent_time(
+        const ConnectionStateOnSentPacket& s) const
+{
+    uint32_t last_sent_us = static_cast<uint32_t>(
+            last_sent_time_.microseconds() - epoch_.microseconds());
+    int32_t age = static_cast<int32_t>(last_sent_us - s.sent_time_us);
+    return time::Timestamp(last_sent_time_.microseconds() - age);
+}
+
+time::Timestamp BandwidthSampler::pkt_sent_time(uint64_t seq_no) const
+{
+    const SentPacketTable& sent_pkts = this->sent_pkts();
+    size_t slot = sent_pkts.find(seq_no);
+    if (slot == SentPacketTable::npos) {
+        return time::Timestamp();
+    }
+    return sent_pkts.sent_time(slot);
 }
 }
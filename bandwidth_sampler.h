@@ -6,11 +6,12 @@
 #include <cassert>
 #include <vector>
 #include <deque>
-#include <map>
 #include <time/timestamp.h>
 #include <common/rate.h>
 #include <common/windowed_filter.h>
 #include <bbr_common.h>
+#include <bbr_histograms.h>
+#include <sent_packet_table.h>
 
 namespace bbr
 {
@@ -47,6 +48,14 @@ public:
         max_ack_height_filter_.reset(new_height, new_time);
     }
 
+    // Forgets all aggregation epochs, keeps the window and the threshold.
+    void clear() {
+        reset(0, 0);
+        aggregation_epoch_start_time_ = time::Timestamp();
+        aggregation_epoch_bytes_ = 0;
+        num_ack_aggregation_epochs_ = 0;
+    }
+
     void set_threshold(double threshold) {
         threshold_ = threshold;
     }
@@ -81,6 +90,8 @@ struct CongestionEventSample {
     // The minimum rtt sample from all acked packets.
     // QuicTime::Delta::Infinite() if no samples are available.
     time::TimeDelta sample_rtt;
+    // The number of acked packets which made a sample.
+    size_t sample_count = 0;
     // For each packet p in acked packets, this is the max value of INFLIGHT(p),
     // where INFLIGHT(p) is the number of bytes acked while p is inflight.
     size_t sample_max_inflight = 0;
@@ -109,17 +120,6 @@ struct BandwidthSample {
 
 class BandwidthSampler
 {
-    struct ConnectionStateOnSentPacket
-    {
-        size_t bytes;
-        time::Timestamp sent_time;
-
-        size_t total_sent_bytes_at_last_acked_pkt;
-        time::Timestamp last_acked_pkt_sent_time;
-        time::Timestamp last_acked_pkt_ack_time;
-
-        SendTimeState state;
-    };
     struct AckPoint
     {
         time::Timestamp ack_time = time::Timestamp::negative_infinity();
@@ -157,6 +157,16 @@ class BandwidthSampler
 
 public:
     BandwidthSampler(int ack_track_win = 5);
+
+    // Back to the state of a new connection. Keeps the allocated buffers,
+    // the shared packet table and the histograms.
+    void reset();
+
+    // Frees the memory used for packets in flight and ack processing while
+    // the connection is idle, it is allocated again on demand. The state is
+    // kept.
+    void release_memory();
+
     void on_packet_sent(uint64_t seq_no, size_t bytes,
             size_t bytes_in_flight,
             time::Timestamp at_time, bool need_retransmite = true);
@@ -170,20 +180,63 @@ public:
     void on_app_limited();
     bool is_app_limited();
 
+    size_t total_bytes_sent() const { return total_bytes_sent_;}
     size_t total_bytes_acked() const { return total_bytes_acked_;}
     size_t total_bytes_lost() const { return total_bytes_lost_;}
     size_t max_ack_height() const { return max_ack_height_tracker_.get();}
+
+    // Record every rtt/bandwidth sample and extra_acked into |histograms|,
+    // nullptr(default) disables it.
+    void set_histograms(BbrHistograms* histograms) { histograms_ = histograms;}
+
+    // Keep the per packet states in |sent_pkts| (shared with the owner of the
+    // packets) instead of a table of its own. Must be set before the first
+    // packet is sent, nullptr(default) uses the sampler's own table.
+    void set_sent_packets(SentPacketTable* sent_pkts) { shared_pkts_ = sent_pkts;}
+
+    // Send time of a tracked packet, invalid if |seq_no| is not tracked.
+    time::Timestamp pkt_sent_time(uint64_t seq_no) const;
+
+    // Take the delivery rate of a sample from the times the peer received
+    // the packets instead of the times their acks arrived, which ack
+    // compression (e.g. Wi-Fi, cellular) squeezes into bursts that
+    // overestimate the bandwidth. The sample is still capped by the send
+    // rate. Packets without a receive time fall back to the ack times.
+    void set_use_receive_times(bool use_receive_times) {
+        use_receive_times_ = use_receive_times;
+    }
 private:
     SendTimeState on_pkt_lost(uint64_t seq_no, size_t bytes);
 
-    BandwidthSample on_pkt_acked(uint64_t seq_no, time::Timestamp ack_time);
+    // Appends the packet's sample to |acked_samples_| and returns its send
+    // state, which is invalid if no sample can be made.
+    SendTimeState on_pkt_acked(uint64_t seq_no, time::Timestamp ack_time,
+            time::Timestamp receive_time);
+
+    // Rate of delivery at the peer since the packet sent with
+    // |total_bytes_acked_at_send| bytes acked, false if unknown.
+    bool receive_rate(size_t total_bytes_acked_at_send,
+            time::Timestamp receive_time, size_t& bytes, int64_t& us);
 private:
     size_t extra_acked(common::BandWidth max_bw, int round_count);
     bool choose_a0(size_t total_bytes_acked, AckPoint& point);
     void connection_state_to_sent_state(const ConnectionStateOnSentPacket& s1,
             SendTimeState& s2);
+    static uint32_t time_gap(time::Timestamp from, time::Timestamp to);
+    time::Timestamp sent_time(const ConnectionStateOnSentPacket& s) const;
+    SentPacketTable& sent_pkts() {
+        return shared_pkts_ ? *shared_pkts_ : own_pkts_;
+    }
+    const SentPacketTable& sent_pkts() const {
+        return shared_pkts_ ? *shared_pkts_ : own_pkts_;
+    }
+    void record_samples();
 private:
     uint64_t last_sent_packet_ = std::numeric_limits<uint64_t>::max();
+    // Origin of ConnectionStateOnSentPacket::sent_time_us, the send time of
+    // the first packet.
+    time::Timestamp epoch_;
+    time::Timestamp last_sent_time_;
 
     size_t total_bytes_sent_ = 0;
     size_t total_bytes_acked_ = 0;
@@ -203,14 +256,64 @@ private:
     // to exit the app-limited phase.
     uint64_t end_of_app_limited_phase_ = std::numeric_limits<uint64_t>::max();
 
-    std::map<uint64_t/*seq no*/, ConnectionStateOnSentPacket> state_map_;
+    SentPacketTable own_pkts_;
+    SentPacketTable* shared_pkts_ = nullptr;
+
+    // Samples of the packets acked by one congestion event, kept as columns
+    // so that they can be reduced in a batch, see reduce_acked_samples().
+    // Reused across events to avoid allocations, unless a stretch ack grew
+    // the columns beyond kMaxRetainedSamples.
+    struct AckedSamples
+    {
+        static constexpr size_t kMaxRetainedSamples = 128;
+
+        std::vector<int64_t> rtt_us;
+        std::vector<int64_t> inflight;
+        // bandwidth = min(send_bytes / send_us, ack_bytes / ack_us)
+        std::vector<double> send_bytes;
+        std::vector<double> send_us;
+        std::vector<double> ack_bytes;
+        std::vector<double> ack_us;
+        std::vector<uint8_t> is_app_limited;
+        // Scratch and output of the reduction, in bits per second.
+        std::vector<double> send_rate;
+        std::vector<double> ack_rate;
+        std::vector<int64_t> bandwidth;
+
+        size_t size() const { return rtt_us.size();}
+        void clear();
+    };
+    AckedSamples acked_samples_;
+
+    struct SampleReduction
+    {
+        int64_t min_rtt_us;
+        int64_t max_inflight;
+        size_t max_bandwidth_index;
+    };
+    // Fills samples.bandwidth and reduces a non-empty batch, with AVX2 when
+    // the build enables it.
+    static SampleReduction reduce_acked_samples(AckedSamples& samples);
 
     RecentAckPoints ack_points_;
     std::deque<AckPoint> a0_candidates_;
 
+    // When the peer received each acked packet (its clock), with the total
+    // acked once it was, see set_use_receive_times(). The points older than
+    // the one a packet was sent after are dropped when it is acked.
+    struct ReceivePoint
+    {
+        size_t total_bytes_acked;
+        time::Timestamp receive_time;
+    };
+    bool use_receive_times_ = false;
+    std::deque<ReceivePoint> receive_points_;
+
     MaxAckHeightTracker max_ack_height_tracker_;
 
     size_t total_bytes_acked_after_last_ack_event_ = 0;
+
+    BbrHistograms* histograms_ = nullptr;
 };
 }
 
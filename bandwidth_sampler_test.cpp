@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <map>
+#include <queue>
 #include <time/timestamp.h>
 #include <common/rate.h>
 #include <bandwidth_sampler.h>
@@ -423,6 +425,7 @@ TEST_F(BandwidthSamplerTest, TwoAckedPacketsPerEvent)
         auto sample = on_congestion_event({i - 1, i}, {});
         EXPECT_EQ(sending_rate, sample.sample_max_bandwidth);
         EXPECT_EQ(time_between_packets, sample.sample_rtt);
+        EXPECT_EQ(2u, sample.sample_count);
         EXPECT_EQ(2 * kRegularPktSize, sample.sample_max_inflight);
         EXPECT_TRUE(sample.last_packet_send_state.is_valid);
         EXPECT_EQ(2 * kRegularPktSize, sample.last_packet_send_state.bytes_in_flight);
@@ -490,6 +493,224 @@ TEST_F(BandwidthSamplerTest, AckHeightRespectBandwidthEstimateUpperBound)
     EXPECT_LT(2 * kRegularPktSize, sample.extra_acked);
 }
 
+TEST_F(BandwidthSamplerTest, StretchAck)
+{
+    auto pkt_time_inter = 1_ms;
+    BandWidth send_bw = kRegularPktSize / pkt_time_inter;
+    send_40pkts_and_ack_first20pkts(pkt_time_inter);
+
+    // One ack for packets 21 to 40, reduced as a batch (including a tail
+    // which does not fill a whole vector).
+    std::set<uint64_t> acked;
+    for (uint64_t i = 21; i <= 40; i++) {
+        acked.insert(i);
+    }
+    auto sample = on_congestion_event(acked, {});
+    EXPECT_EQ(pkt_time_inter, sample.sample_rtt);
+    EXPECT_EQ(20 * kRegularPktSize, sample.sample_max_inflight);
+    EXPECT_LT(0_bps, sample.sample_max_bandwidth);
+    EXPECT_GE(send_bw, sample.sample_max_bandwidth);
+    EXPECT_FALSE(sample.sample_is_app_limited);
+    EXPECT_EQ(40 * kRegularPktSize, sample.last_packet_send_state.total_bytes_sent);
+}
+
+TEST_F(BandwidthSamplerTest, RecordsHistograms)
+{
+    bbr::BbrHistograms histograms;
+    sampler_.set_histograms(&histograms);
+
+    auto time_between_packets = 10_ms;
+    for (uint64_t i = 1; i < 21; i++) {
+        send_pkt(i);
+        clock_ += time_between_packets;
+        if (i % 2 != 0) {
+            continue;
+        }
+        on_congestion_event({i - 1, i}, {});
+    }
+    // One rtt/bandwidth sample per acked packet, one extra_acked per event.
+    EXPECT_EQ(20u, histograms.rtt_us.count());
+    EXPECT_EQ(20u, histograms.bandwidth_bps.count());
+    EXPECT_EQ(10u, histograms.extra_acked_bytes.count());
+    EXPECT_EQ(static_cast<uint64_t>(time_between_packets.value()),
+            histograms.rtt_us.min());
+    EXPECT_GE(histograms.rtt_us.percentile(99),
+            static_cast<uint64_t>((2 * time_between_packets).value()));
+    EXPECT_EQ(0u, histograms.ack_processing_ns.count());
+}
+
+TEST_F(BandwidthSamplerTest, PackedStateWraps)
+{
+    // Lose untracked bytes so that the low 32 bits of total_bytes_lost wrap
+    // while packets are in flight.
+    const size_t lost_before = (size_t(1) << 32) - kRegularPktSize;
+    sampler_.on_congestion_event(clock_, {}, {{0, lost_before}},
+            max_bw_, bw_upper_bound_, round_count_);
+
+    send_pkt(1);
+    clock_ += 1_ms;
+    ack_pkt(1);
+
+    // The 32-bit microsecond offsets from the first packet wrap after ~71
+    // minutes, in the middle of the following packets.
+    clock_ = Timestamp((int64_t(1) << 32) - 10 * 1000);
+    for (uint64_t i = 2; i <= 21; i++) {
+        send_pkt(i);
+        clock_ += 1_ms;
+    }
+    sampler_.on_congestion_event(clock_, {}, {{0, 2 * kRegularPktSize}},
+            max_bw_, bw_upper_bound_, round_count_);
+
+    for (uint64_t i = 2; i <= 21; i++) {
+        auto sample = ack_pkt_inner(i);
+        EXPECT_EQ(20_ms, sample.rtt) << "i is " << i;
+        EXPECT_EQ(i * kRegularPktSize, sample.state_at_send.total_bytes_sent);
+        EXPECT_EQ(lost_before, sample.state_at_send.total_bytes_lost);
+        EXPECT_EQ(kRegularPktSize, sample.state_at_send.total_bytes_acked);
+        clock_ += 1_ms;
+    }
+    EXPECT_EQ(lost_before + 2 * kRegularPktSize, sampler_.total_bytes_lost());
+}
+
+TEST_F(BandwidthSamplerTest, LargePacketsAreNotTruncated)
+{
+    // GSO/TSO sized sends larger than 64KB.
+    const size_t kLargePktSize = 100 * 1000;
+    sampler_.on_packet_sent(1, kLargePktSize, 0, clock_, true);
+    sampler_.on_packet_sent(2, kLargePktSize, kLargePktSize, clock_, true);
+    clock_ += 10_ms;
+    sampler_.on_congestion_event(clock_, {{1, kLargePktSize, clock_}}, {},
+            max_bw_, bw_upper_bound_, round_count_);
+    EXPECT_EQ(kLargePktSize, sampler_.total_bytes_acked());
+
+    sampler_.on_pkt_neutered(2);
+    sampler_.on_packet_sent(3, kLargePktSize, 0, clock_, true);
+    clock_ += 10_ms;
+    auto sample = sampler_.on_congestion_event(clock_, {{3, kLargePktSize, clock_}},
+            {}, max_bw_, bw_upper_bound_, round_count_);
+    EXPECT_EQ(2 * kLargePktSize, sampler_.total_bytes_acked());
+    EXPECT_EQ(kLargePktSize, sample.last_packet_send_state.bytes_in_flight);
+}
+
+TEST_F(BandwidthSamplerTest, Reset)
+{
+    auto pkt_time_inter = 10_ms;
+    auto expected_bw = kRegularPktSize / pkt_time_inter;
+    for (int i = 1; i <= 10; i++) {
+        send_pkt(i);
+        clock_ += pkt_time_inter;
+    }
+    for (int i = 1; i <= 5; i++) {
+        ack_pkt(i);
+    }
+    lose_pkt(6);
+    sampler_.on_app_limited();
+
+    // A new connection reusing the sampler starts over from seq_no 1.
+    sampler_.reset();
+    sent_pkts_.clear();
+    bytes_in_flight_ = 0;
+    EXPECT_EQ(0u, sampler_.total_bytes_sent());
+    EXPECT_EQ(0u, sampler_.total_bytes_acked());
+    EXPECT_EQ(0u, sampler_.total_bytes_lost());
+    EXPECT_EQ(app_limited_at_start_, sampler_.is_app_limited());
+    EXPECT_EQ(0u, sampler_.max_ack_height());
+
+    clock_ += 10000_ms;
+    for (int i = 1; i < 20; i++) {
+        send_pkt(i);
+        clock_ += pkt_time_inter;
+        EXPECT_EQ(expected_bw, ack_pkt(i)) << "i is " << i;
+    }
+    EXPECT_EQ(19 * kRegularPktSize, sampler_.total_bytes_acked());
+}
+
+TEST_F(BandwidthSamplerTest, ReleaseMemoryWhileIdle)
+{
+    auto pkt_time_inter = 10_ms;
+    auto expected_bw = kRegularPktSize / pkt_time_inter;
+    for (int i = 1; i < 10; i++) {
+        send_pkt(i);
+        clock_ += pkt_time_inter;
+        EXPECT_EQ(expected_bw, ack_pkt(i));
+    }
+    size_t acked = sampler_.total_bytes_acked();
+
+    // Idle: the estimates survive, sampling goes on after the next send.
+    sampler_.release_memory();
+    EXPECT_EQ(acked, sampler_.total_bytes_acked());
+    for (int i = 10; i < 20; i++) {
+        send_pkt(i);
+        clock_ += pkt_time_inter;
+        EXPECT_EQ(expected_bw, ack_pkt(i)) << "i is " << i;
+    }
+}
+
+namespace
+{
+// A 10.24Mbps bottleneck (one packet per ms) with a 20ms rtt, the sender
+// keeping 60 packets in flight and sending as soon as a packet is acked.
+// The acks of the packets received within each 40ms are released together,
+// 10us apart. Returns the max bandwidth sample.
+BandWidth max_bw_with_compressed_acks(bool use_receive_times)
+{
+    struct Ack
+    {
+        int64_t ack_time_us;
+        uint64_t seq_no;
+        int64_t receive_time_us;
+        bool operator > (const Ack& other) const {
+            return ack_time_us > other.ack_time_us;
+        }
+    };
+    bbr::BandwidthSampler sampler(0);
+    sampler.set_use_receive_times(use_receive_times);
+    std::priority_queue<Ack, std::vector<Ack>, std::greater<Ack>> acks;
+    std::map<int64_t, int> acks_in_window;
+    int64_t last_receive_us = 0;
+    size_t bytes_in_flight = 0;
+    uint64_t next_seq_no = 1;
+
+    auto send = [&](int64_t now_us) {
+        sampler.on_packet_sent(next_seq_no, kRegularPktSize, bytes_in_flight,
+                Timestamp(now_us), true);
+        bytes_in_flight += kRegularPktSize;
+        int64_t receive_us = std::max(now_us + 10000, last_receive_us + 1000);
+        last_receive_us = receive_us;
+        int64_t window = receive_us / 40000;
+        int64_t ack_us = (window + 1) * 40000 + 10000 + acks_in_window[window]++ * 10;
+        acks.push({ack_us, next_seq_no++, receive_us});
+    };
+
+    for (int i = 0; i < 60; i++) {
+        send(0);
+    }
+    BandWidth max_bw = 0_mbps;
+    for (int i = 0; i < 500; i++) {
+        Ack ack = acks.top();
+        acks.pop();
+        bytes_in_flight -= kRegularPktSize;
+        bbr::internal::AckedPacket acked_pkt{ack.seq_no, kRegularPktSize,
+            Timestamp(ack.receive_time_us)};
+        auto sample = sampler.on_congestion_event(Timestamp(ack.ack_time_us),
+                {acked_pkt}, {}, max_bw, 1000_mbps, 0);
+        max_bw = std::max(max_bw, sample.sample_max_bandwidth);
+        send(ack.ack_time_us);
+    }
+    return max_bw;
+}
+}
+
+TEST(BandwidthSamplerReceiveTimeTest, ImmuneToAckCompression)
+{
+    const BandWidth bottleneck(kRegularPktSize * 8 * 1000);
+    BandWidth from_ack_times = max_bw_with_compressed_acks(false);
+    BandWidth from_receive_times = max_bw_with_compressed_acks(true);
+    EXPECT_GT(from_ack_times, bottleneck * 1.1);
+    EXPECT_LE(from_receive_times, bottleneck);
+    EXPECT_GE(from_receive_times, bottleneck * 0.9);
+}
+
 class MaxAckHeightTrackerTest : public testing::Test {
 public:
     MaxAckHeightTrackerTest()
@@ -27,17 +27,24 @@ struct SendingPacket {
     std::shared_ptr<uint8_t> shared_ptr_pkt;
 
     size_t size = 0;
+
+    //stream of a coupled sender, see CoupledSendQueue
+    uint32_t stream_id = 0;
 };
 
 struct AckedPacket {
     uint64_t seq_no = 0;
     time::Timestamp arrival_time;  //time of this packet received by peer
+    bool ecn_ce = false;  //arrived ECN-CE marked, see Bbrparams::ecn_enabled
 };
 
 struct AckedTrunk {
     uint64_t seq_no_begin = 0;
     uint64_t seq_no_end = 0;
     std::vector<time::Timestamp> arrival_times;
+    //packets of the trunk which arrived ECN-CE marked, e.g. the increase of
+    //the ECN-CE count of a QUIC ack frame
+    uint64_t ecn_ce_count = 0;
 };
 
 }
@@ -4,95 +4,157 @@
 namespace bbr
 {
 using namespace common::rate;
-#define BBR_MODE_DISPATCH(member_function_call)      \
-  (cur_mode_ == BbrMode::STARTUP                        \
-       ? (mode_start_up_.member_function_call)             \
-       : (cur_mode_ == BbrMode::PROBE_BW                \
-              ? (mode_probe_bw_.member_function_call)     \
-              : (cur_mode_ == BbrMode::DRAIN            \
-                     ? (mode_drain_.member_function_call) \
-                     : (mode_probe_rtt_.member_function_call))))
-
-// Constants based on TCP defaults.
-// The minimum CWND to ensure delayed acks don't reduce bandwidth measurements.
-// Does not inflate the pacing rate.
-namespace default_params
+template <typename Profile>
+BasicBbrAlgorithm<Profile>::BasicBbrAlgorithm(const Bbrparams& params,
+        size_t init_cwnd, time::TimeDelta init_rtt, time::Timestamp now)
+    :params_(params),
+     random_(static_cast<uint64_t>(now.microseconds())),
+     init_cwnd_(init_cwnd),
+     init_rtt_(init_rtt),
+     cur_cwnd_(init_cwnd),
+     pacing_rate_(0),
+     model_(params_.get(), init_rtt, now,
+             default_params::kInitialPacingGain,
+             default_params::kInitialPacingGain),
+     cur_mode_(BbrMode::STARTUP),
+     mode_start_up_(this, &model_),
+     mode_drain_(this, &model_),
+     mode_probe_bw_(this, &model_),
+     mode_probe_rtt_(this, &model_),
+     last_quiescence_start_(time::Timestamp::positive_infinity())
 {
-const size_t kMinCwnd= 4 * Bbrparams::kDefaultTCPMSS;
-
-const float kInitialPacingGain = 2.885f;
+    dispatch([&](auto& mode) { mode.enter(now, nullptr);});
+}
 
-const int kMaxModeChanges = 4;
+template <typename Profile>
+void BasicBbrAlgorithm<Profile>::reset(time::Timestamp now)
+{
+    random_ = common::Random(static_cast<uint64_t>(now.microseconds()));
+    cur_cwnd_ = init_cwnd_;
+    pacing_rate_ = common::BitRate(0);
+    model_.reset(init_rtt_, now, default_params::kInitialPacingGain,
+            default_params::kInitialPacingGain);
+    cur_mode_ = BbrMode::STARTUP;
+    mode_start_up_ = BbrStartupMode(this, &model_);
+    mode_drain_ = BbrDrainMode(this, &model_);
+    mode_probe_bw_ = BbrProbeBandwidth(this, &model_);
+    mode_probe_rtt_ = BbrProbeRtt(this, &model_);
+    last_quiescence_start_ = time::Timestamp::positive_infinity();
+    dispatch([&](auto& mode) { mode.enter(now, nullptr);});
 }
 
-void BbrAlgorithm::on_packet_sent(uint64_t pkt_no,
-        size_t bytes, size_t bytes_in_flight,
-        bool need_retransmitted,
-        time::Timestamp sent_time)
+template <typename Profile>
+bool BasicBbrAlgorithm<Profile>::warm_start(const PathInfo& path,
+        time::Timestamp now)
 {
-    if(bytes_in_flight == 0) {
-        on_exit_quiescence(sent_time);
+    if (!path.is_valid() || cur_mode_ != BbrMode::STARTUP ||
+            model_.total_bytes_sent() != 0) {
+        return false;
+    }
+    const common::BandWidth bw = path.max_bw * params().resume_bw_fraction;
+    if (bw == 0_mbps) {
+        return false;
     }
-    model_.on_pkt_sent(pkt_no, bytes, bytes_in_flight,
-            sent_time, need_retransmitted);
+    model_.warm_start(bw, path.min_rtt, path.inflight_hi, now);
+    mode_start_up_.skip(bw);
+
+    NullBbrObserver observer;
+    switch_mode(BbrMode::PROBE_BW, now, nullptr, observer);
+    model_.set_pacing_gain(params().probe_bw_default_pacing_gain);
+    model_.set_cwnd_gain(params().probe_bw_cwnd_gain);
+
+    pacing_rate_ = model_.pacing_gain() * model_.estimated_bw();
+    cur_cwnd_ = std::max(std::min(target_cwnd(model_.cwnd_gain()),
+            cwnd_upper_limit()), init_cwnd_);
+    return true;
 }
 
-void BbrAlgorithm::on_congestion_event(
-    size_t prior_inflight,
-    time::Timestamp at_time,
-    const std::vector<internal::AckedPacket>& acked_packets,
-    const std::vector<internal::LostPacket>& lost_packets)
+template <typename Profile>
+BbrHibernationState BasicBbrAlgorithm<Profile>::hibernation_state() const
 {
-    BbrCongestionEvent congestion_event;
-    congestion_event.prior_cwnd = cur_cwnd_;
-    congestion_event.prior_bytes_in_flight = prior_inflight;
-    congestion_event.is_probing_for_bandwidth =
-            BBR_MODE_DISPATCH(is_probing());
-
-    model_.on_congestion_event(acked_packets, lost_packets,
-            congestion_event, at_time);
-
-    int mode_changes_allowed = default_params::kMaxModeChanges;
-    while(true)
-    {
-        auto next_mode = BBR_MODE_DISPATCH(
-                on_congestion_event(prior_inflight, at_time,
-                        acked_packets, lost_packets, congestion_event));
-        if (next_mode == cur_mode_) {
-            break;
-        }
+    BbrHibernationState state;
+    state.max_bw = model_.max_bw();
+    state.min_rtt = model_.min_rtt();
+    state.min_rtt_timestamp = model_.min_rtt_timestamp();
+    state.inflight_hi = model_.inflight_hi();
+    state.full_bw_reached = mode_start_up_.full_bw_reached();
+    return state;
+}
 
-        //TODO: log when mode changed
-        BBR_MODE_DISPATCH(leave(at_time, &congestion_event));
-        cur_mode_ = next_mode;
-        BBR_MODE_DISPATCH(enter(at_time, &congestion_event));
-        --mode_changes_allowed;
-        if(mode_changes_allowed < 0) {
-            //log warning
-            break;
+template <typename Profile>
+bool BasicBbrAlgorithm<Profile>::restore(const BbrHibernationState& state,
+        time::Timestamp now)
+{
+    if (!state.is_valid() || cur_mode_ != BbrMode::STARTUP ||
+            model_.total_bytes_sent() != 0) {
+        return false;
+    }
+    model_.warm_start(state.max_bw, state.min_rtt, state.inflight_hi,
+            state.min_rtt_timestamp);
+    if (!state.full_bw_reached) {
+        if (state.max_bw > 0_mbps) {
+            pacing_rate_ = model_.pacing_gain() * model_.estimated_bw();
         }
+        return true;
     }
+    mode_start_up_.skip(state.max_bw);
 
-    //TODO: implememt it
-//    model_.end_congestion_event(uint64_t least_unacked_pkt_no,
-//            const BbrCongestionEvent& congestion_event);
-    update_pacing_rate(congestion_event.bytes_acked);
-    assert(pacing_rate_ > 0_mbps);
+    NullBbrObserver observer;
+    switch_mode(BbrMode::PROBE_BW, now, nullptr, observer);
+    model_.set_pacing_gain(params().probe_bw_default_pacing_gain);
+    model_.set_cwnd_gain(params().probe_bw_cwnd_gain);
 
-    update_cwnd(congestion_event.bytes_acked);
-    assert(cur_cwnd_ > 0);
+    pacing_rate_ = model_.pacing_gain() * model_.estimated_bw();
+    cur_cwnd_ = std::max(std::min(target_cwnd(model_.cwnd_gain()),
+            cwnd_upper_limit()), init_cwnd_);
+    return true;
+}
 
-    if (congestion_event.bytes_in_flight == 0) {
-        on_exit_quiescence(at_time);
+template <typename Profile>
+PathInfo BasicBbrAlgorithm<Profile>::path_info() const
+{
+    PathInfo path;
+    if (!mode_start_up_.full_bw_reached()) {
+        return path;
     }
+    path.max_bw = model_.max_bw();
+    path.min_rtt = model_.min_rtt();
+    path.inflight_hi = model_.inflight_hi();
+    return path;
+}
+
+template <typename Profile>
+void BasicBbrAlgorithm<Profile>::on_packet_sent(uint64_t pkt_no,
+        size_t bytes, size_t bytes_in_flight,
+        bool need_retransmitted,
+        time::Timestamp sent_time)
+{
+    NullBbrObserver observer;
+    on_packet_sent(pkt_no, bytes, bytes_in_flight, need_retransmitted,
+            sent_time, observer);
+}
+
+template <typename Profile>
+void BasicBbrAlgorithm<Profile>::on_congestion_event(
+    size_t prior_inflight,
+    time::Timestamp at_time,
+    const std::vector<internal::AckedPacket>& acked_packets,
+    const std::vector<internal::LostPacket>& lost_packets,
+    size_t ecn_ce_count)
+{
+    NullBbrObserver observer;
+    on_congestion_event(prior_inflight, at_time, acked_packets,
+            lost_packets, observer, ecn_ce_count);
 }
 
-size_t BbrAlgorithm::can_send(size_t bytes_inflight) const
+template <typename Profile>
+size_t BasicBbrAlgorithm<Profile>::can_send(size_t bytes_inflight) const
 {
     return bytes_inflight > cur_cwnd_ ? 0 : cur_cwnd_ - bytes_inflight;
 }
 
-void BbrAlgorithm::update_cwnd(size_t bytes_acked)
+template <typename Profile>
+void BasicBbrAlgorithm<Profile>::update_cwnd(size_t bytes_acked)
 {
     auto prior_cwnd = cur_cwnd_;
     auto target = target_cwnd(model_.cwnd_gain());
@@ -109,6 +171,10 @@ void BbrAlgorithm::update_cwnd(size_t bytes_acked)
 
     auto desired_cwnd = cur_cwnd_;
     cur_cwnd_ = std::min(cur_cwnd_, cwnd_upper_limit());
+    if (model_.latency_capped()) {
+        cur_cwnd_ = std::min(cur_cwnd_, model_.bdp(model_.estimated_bw(),
+                    common::Gain::one() + params().latency_cap_headroom));
+    }
     auto limitted_cnwd = cur_cwnd_;
     cur_cwnd_ = std::max(cur_cwnd_, min_cwnd());
 
@@ -116,7 +182,8 @@ void BbrAlgorithm::update_cwnd(size_t bytes_acked)
     (void) limitted_cnwd;
 }
 
-void BbrAlgorithm::update_pacing_rate(size_t bytes_acked)
+template <typename Profile>
+void BasicBbrAlgorithm<Profile>::update_pacing_rate(size_t bytes_acked)
 {
     if(model_.estimated_bw() == 0_mbps) {
         return;
@@ -128,9 +195,14 @@ void BbrAlgorithm::update_pacing_rate(size_t bytes_acked)
         pacing_rate_ = cur_cwnd_ / model_.min_rtt();
         return;
     }
-    auto target_rate = model_.pacing_gain() * model_.estimated_bw();
+    auto pacing_gain = model_.pacing_gain();
+    if (model_.latency_capped() &&
+            params().latency_cap_pacing_gain < pacing_gain) {
+        pacing_gain = params().latency_cap_pacing_gain;
+    }
+    auto target_rate = pacing_gain * model_.estimated_bw();
 
-    if (mode_start_up_.full_bw_reached()) {
+    if (mode_start_up_.full_bw_reached() || model_.latency_capped()) {
         pacing_rate_ = target_rate;
         return;
     }
@@ -140,32 +212,20 @@ void BbrAlgorithm::update_pacing_rate(size_t bytes_acked)
     }
 }
 
-size_t BbrAlgorithm::target_cwnd(float gain)
+template <typename Profile>
+size_t BasicBbrAlgorithm<Profile>::target_cwnd(common::Gain gain)
 {
     return std::max(model_.bdp(model_.estimated_bw(), gain),
             min_cwnd());
 }
 
-size_t BbrAlgorithm::cwnd_upper_limit()
+template <typename Profile>
+size_t BasicBbrAlgorithm<Profile>::cwnd_upper_limit()
 {
-    auto upper_limit_by_mode = BBR_MODE_DISPATCH(cwnd_upper_limit());
+    auto upper_limit_by_mode = dispatch(
+            [](auto& mode) { return mode.cwnd_upper_limit();});
     return upper_limit_by_mode;
 }
 
-void BbrAlgorithm::on_exit_quiescence(time::Timestamp at_time)
-{
-    if(!last_quiescence_start_.is_valid()) {
-        return;
-    }
-
-    auto next_mode = BBR_MODE_DISPATCH( on_exit_quiescence(
-            std::min(at_time, last_quiescence_start_), at_time));
-    if (next_mode != cur_mode_) {
-        BBR_MODE_DISPATCH(leave(at_time, nullptr));
-        cur_mode_ = next_mode;
-        BBR_MODE_DISPATCH(enter(at_time, nullptr));
-    }
-    last_quiescence_start_ = time::Timestamp::positive_infinity();
+BBR_INSTANTIATE_FOR_PROFILES(BasicBbrAlgorithm);
 }
-}
-
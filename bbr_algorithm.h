@@ -4,6 +4,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <bbr_model.h>
+#include <bbr_profiles.h>
+#include <path_cache.h>
 #include <common/rate.h>
 #include <common/random.h>
 #include <bbr_mode.h>
@@ -11,64 +13,344 @@
 #include <bbr_drain.h>
 #include <bbr_probe_bw.h>
 #include <bbr_probe_rtt.h>
+#include <bbr_observer.h>
 
 namespace bbr
 {
+// Constants based on TCP defaults.
+namespace default_params
+{
+// The minimum CWND to ensure delayed acks don't reduce bandwidth measurements.
+// Does not inflate the pacing rate.
+constexpr size_t kMinCwnd = 4 * Bbrparams::kDefaultTCPMSS;
+
+constexpr size_t kInitCwnd = 10 * Bbrparams::kDefaultTCPMSS;
+
+// Used as min_rtt until the first sample.
+constexpr time::TimeDelta kInitRtt {100 * 1000};
+
+constexpr common::Gain kInitialPacingGain(2.885);
+}
 
-class BbrAlgorithm
+// What a hibernating sender keeps of its BbrAlgorithm, see
+// BbrAlgorithm::hibernation_state().
+struct BbrHibernationState
+{
+    common::BandWidth max_bw {0};
+    time::TimeDelta min_rtt;
+    time::Timestamp min_rtt_timestamp;
+    size_t inflight_hi = BbrModel::kDefaultInflightBytes;
+    // STARTUP had ended.
+    bool full_bw_reached = false;
+
+    bool is_valid() const { return min_rtt.is_valid();}
+};
+
+// Profile: where the parameters come from, see RuntimeProfile. The per-ack
+// path of a compile-time profile such as profiles::LowLatency reads no
+// parameter from memory.
+template <typename Profile = RuntimeProfile>
+class BasicBbrAlgorithm
 {
 public:
+    using Model = BasicBbrModel<Profile>;
+
+    // |params| is copied, typically one of the profiles in bbr_profiles.h.
+    // Ignored unless Profile is RuntimeProfile.
+    explicit BasicBbrAlgorithm(const Bbrparams& params = profiles::kDefault,
+            size_t init_cwnd = default_params::kInitCwnd,
+            time::TimeDelta init_rtt = default_params::kInitRtt,
+            time::Timestamp now = time::Timestamp::now());
+
+    // Back to the state right after construction, as if |now| was the
+    // construction time, so that one instance can serve several connections.
+    // The profile, the shared packet table and the histograms are kept.
+    void reset(time::Timestamp now);
+
+    // Careful resume: a connection which has not sent anything yet starts
+    // in PROBE_BW from |path|, learned by a recent connection to the same
+    // destination, instead of probing from scratch in STARTUP.
+    // Only resume_bw_fraction of the cached bandwidth is assumed, cwnd is set
+    // from it and the cached min_rtt and sending is paced at that rate;
+    // PROBE_BW then probes for more, and losses lower the estimates as usual.
+    // Returns false, doing nothing, if |path| is invalid or too late.
+    bool warm_start(const PathInfo& path, time::Timestamp now);
+
+    // The estimates to keep in a PathCache, invalid before the end of
+    // STARTUP.
+    PathInfo path_info() const;
+
+    // The estimates to rebuild this instance from with restore(), after
+    // freeing it while quiescent.
+    BbrHibernationState hibernation_state() const;
+
+    // Takes over |state| of a connection which has not sent anything yet,
+    // as is: unlike warm_start(), the bandwidth is not scaled down and
+    // min_rtt keeps its timestamp, so it expires when it would have.
+    // PROBE_BW restarts at its default phase, as after any quiescence,
+    // if STARTUP had ended; otherwise STARTUP goes on.
+    // Returns false, doing nothing, if |state| is invalid or too late.
+    bool restore(const BbrHibernationState& state, time::Timestamp now);
+
+    // Frees the memory used for packets in flight while idle.
+    void release_memory() { model_.release_memory();}
+
     void on_packet_sent(uint64_t pkt_no,
             size_t bytes, size_t bytes_in_flight,
             bool need_retransmitted,
             time::Timestamp sent_time);
 
+    // |ecn_ce_count|: how many of |acked_packets| arrived ECN-CE marked.
     void on_congestion_event(
         size_t prior_inflight,
         time::Timestamp at_time,
         const std::vector<internal::AckedPacket>& acked_packets,
-        const std::vector<internal::LostPacket>& lost_packets);
+        const std::vector<internal::LostPacket>& lost_packets,
+        size_t ecn_ce_count = 0);
+
+    // Same as above, reporting mode/phase transitions to |observer|,
+    // see NullBbrObserver.
+    template <typename Observer>
+    void on_packet_sent(uint64_t pkt_no,
+            size_t bytes, size_t bytes_in_flight,
+            bool need_retransmitted,
+            time::Timestamp sent_time,
+            Observer& observer);
+
+    template <typename Observer>
+    void on_congestion_event(
+        size_t prior_inflight,
+        time::Timestamp at_time,
+        const std::vector<internal::AckedPacket>& acked_packets,
+        const std::vector<internal::LostPacket>& lost_packets,
+        Observer& observer,
+        size_t ecn_ce_count = 0);
 
     size_t can_send(size_t bytes_inflight) const;
 
-    size_t min_cwnd() const {return params_.min_cwnd;}
+    size_t min_cwnd() const {return params().min_cwnd;}
 
     size_t cwnd() const { return cur_cwnd_;}
 
-    size_t target_cwnd(float gain);
+    common::BandWidth pacing_rate() const { return pacing_rate_;}
+
+    BbrMode mode() const { return cur_mode_;}
+
+    const Model& model() const { return model_;}
+
+    void set_histograms(BbrHistograms* histograms) {
+        model_.set_histograms(histograms);
+    }
+
+    // See ProbeRttCoordinator, not owned.
+    void set_probe_rtt_coordinator(ProbeRttCoordinator* coordinator) {
+        model_.set_probe_rtt_coordinator(coordinator);
+    }
+
+    void set_sent_packets(SentPacketTable* sent_pkts) {
+        model_.set_sent_packets(sent_pkts);
+    }
+
+    size_t target_cwnd(common::Gain gain);
 
     common::Random& random() { return random_; }
 
-    Bbrparams& params() { return params_;}
+    const Bbrparams& params() const { return params_.get();}
 
     size_t target_inflight() const;
 
 private:
+    static const int kMaxModeChanges = 4;
+
+    // Calls |f| with the object of the current mode.
+    template <typename F>
+    auto dispatch(F&& f) {
+        switch (cur_mode_) {
+        case BbrMode::STARTUP:
+            return f(mode_start_up_);
+        case BbrMode::PROBE_BW:
+            return f(mode_probe_bw_);
+        case BbrMode::DRAIN:
+            return f(mode_drain_);
+        default:
+            return f(mode_probe_rtt_);
+        }
+    }
+
+    // Installs a BbrTransitionSink forwarding to an enabled |observer| in
+    // the model for the lifetime of the scope, does nothing otherwise.
+    template <typename Observer>
+    class ObserverScope
+    {
+    public:
+        ObserverScope(Model& model, Observer& observer, time::Timestamp now)
+            : model_(model), sink_(observer, now)
+        {
+            if constexpr (Observer::kEnabled) {
+                model_.set_transition_sink(&sink_);
+            }
+        }
+
+        ~ObserverScope() {
+            if constexpr (Observer::kEnabled) {
+                model_.set_transition_sink(nullptr);
+            }
+        }
+    private:
+        Model& model_;
+        internal::ObserverTransitionSink<Observer> sink_;
+    };
+
     void update_cwnd(size_t bytes_acked);
     void update_pacing_rate(size_t bytes_acked);
 
     size_t cwnd_upper_limit();
 
-    void on_exit_quiescence(time::Timestamp at_time);
+    template <typename Observer>
+    void on_exit_quiescence(time::Timestamp at_time, Observer& observer);
+
+    template <typename Observer>
+    void switch_mode(BbrMode next_mode, time::Timestamp at_time,
+            const BbrCongestionEvent* congestion_event, Observer& observer);
+
 
 private:
-    Bbrparams params_;
+    internal::ProfileParams<Profile> params_;
     common::Random random_;
 
     const size_t init_cwnd_;
+    const time::TimeDelta init_rtt_;
     size_t cur_cwnd_;
     common::BitRate pacing_rate_;
 
-    BbrModel model_;
+    Model model_;
 
     BbrMode cur_mode_;
 
-    BbrStartupMode mode_start_up_;
-    BbrDrainMode mode_drain_;
-    BbrProbeBandwidth mode_probe_bw_;
-    BbrProbeRtt mode_probe_rtt_;
+    BbrStartupMode<Profile> mode_start_up_;
+    BbrDrainMode<Profile> mode_drain_;
+    BbrProbeBandwidth<Profile> mode_probe_bw_;
+    BbrProbeRtt<Profile> mode_probe_rtt_;
 
     time::Timestamp last_quiescence_start_;
 };
+
+using BbrAlgorithm = BasicBbrAlgorithm<>;
+
+template <typename Profile>
+template <typename Observer>
+void BasicBbrAlgorithm<Profile>::on_packet_sent(uint64_t pkt_no,
+        size_t bytes, size_t bytes_in_flight,
+        bool need_retransmitted,
+        time::Timestamp sent_time,
+        Observer& observer)
+{
+    if(bytes_in_flight == 0) {
+        ObserverScope<Observer> scope(model_, observer, sent_time);
+        on_exit_quiescence(sent_time, observer);
+    }
+    model_.on_pkt_sent(pkt_no, bytes, bytes_in_flight,
+            sent_time, need_retransmitted);
+}
+
+template <typename Profile>
+template <typename Observer>
+void BasicBbrAlgorithm<Profile>::on_congestion_event(
+    size_t prior_inflight,
+    time::Timestamp at_time,
+    const std::vector<internal::AckedPacket>& acked_packets,
+    const std::vector<internal::LostPacket>& lost_packets,
+    Observer& observer,
+    size_t ecn_ce_count)
+{
+    // Phase and inflight_hi changes are reported where they are made.
+    ObserverScope<Observer> scope(model_, observer, at_time);
+    [[maybe_unused]] const bool prior_full_bw_reached =
+            mode_start_up_.full_bw_reached();
+
+    BbrCongestionEvent congestion_event;
+    congestion_event.prior_cwnd = cur_cwnd_;
+    congestion_event.prior_bytes_in_flight = prior_inflight;
+    congestion_event.is_probing_for_bandwidth =
+            dispatch([](auto& mode) { return mode.is_probing();});
+    congestion_event.ecn_ce_count = ecn_ce_count;
+
+    model_.on_congestion_event(acked_packets, lost_packets,
+            congestion_event, at_time);
+
+    int mode_changes_allowed = kMaxModeChanges;
+    while(true)
+    {
+        auto next_mode = dispatch([&](auto& mode) {
+            return mode.on_congestion_event(prior_inflight, at_time,
+                    acked_packets, lost_packets, congestion_event);
+        });
+        if (next_mode == cur_mode_) {
+            break;
+        }
+
+        switch_mode(next_mode, at_time, &congestion_event, observer);
+        --mode_changes_allowed;
+        if(mode_changes_allowed < 0) {
+            //log warning
+            break;
+        }
+    }
+
+    //TODO: implememt it
+//    model_.end_congestion_event(uint64_t least_unacked_pkt_no,
+//            const BbrCongestionEvent& congestion_event);
+    update_pacing_rate(congestion_event.bytes_acked);
+    assert(pacing_rate_ > common::BandWidth(0));
+
+    update_cwnd(congestion_event.bytes_acked);
+    assert(cur_cwnd_ > 0);
+
+    if (congestion_event.bytes_in_flight == 0) {
+        on_exit_quiescence(at_time, observer);
+    }
+
+    if constexpr (Observer::kEnabled) {
+        if (mode_start_up_.full_bw_reached() && !prior_full_bw_reached) {
+            observer.on_full_bw_reached(model_.max_bw(), at_time);
+        }
+    }
+}
+
+template <typename Profile>
+template <typename Observer>
+void BasicBbrAlgorithm<Profile>::on_exit_quiescence(time::Timestamp at_time,
+        Observer& observer)
+{
+    if(!last_quiescence_start_.is_valid()) {
+        return;
+    }
+
+    auto next_mode = dispatch([&](auto& mode) {
+        return mode.on_exit_quiescence(
+                std::min(at_time, last_quiescence_start_), at_time);
+    });
+    if (next_mode != cur_mode_) {
+        switch_mode(next_mode, at_time, nullptr, observer);
+    }
+    last_quiescence_start_ = time::Timestamp::positive_infinity();
+}
+
+template <typename Profile>
+template <typename Observer>
+void BasicBbrAlgorithm<Profile>::switch_mode(BbrMode next_mode,
+        time::Timestamp at_time, const BbrCongestionEvent* congestion_event,
+        Observer& observer)
+{
+    dispatch([&](auto& mode) { mode.leave(at_time, congestion_event);});
+    if constexpr (Observer::kEnabled) {
+        observer.on_mode_leave(cur_mode_, at_time);
+    }
+    cur_mode_ = next_mode;
+    dispatch([&](auto& mode) { mode.enter(at_time, congestion_event);});
+    if constexpr (Observer::kEnabled) {
+        observer.on_mode_enter(cur_mode_, at_time);
+    }
+}
 }
 #endif
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <bbr_algorithm.h>
+
+using BbrAlgorithm = bbr::BbrAlgorithm;
+using BbrHibernationState = bbr::BbrHibernationState;
+using BbrMode = bbr::BbrMode;
+using namespace bbr::common::rate;
+using namespace bbr::time;
+
+namespace
+{
+const size_t kPktSize = 1200;
+const TimeDelta kRtt(20 * 1000);
+// Not 0, which would seed common::Random with 0.
+const Timestamp kStart(1000 * 1000);
+
+// Sends |pkts| packets back to back and acks them all one rtt later.
+template <typename Algorithm>
+void run_round(Algorithm& bbr, Timestamp& now, uint64_t& next_seq_no,
+        size_t pkts)
+{
+    std::vector<bbr::internal::AckedPacket> acked;
+    size_t inflight = 0;
+    for (size_t i = 0; i < pkts; i++) {
+        bbr.on_packet_sent(next_seq_no, kPktSize, inflight, true, now);
+        acked.push_back({next_seq_no, kPktSize, now + kRtt / 2});
+        next_seq_no++;
+        inflight += kPktSize;
+    }
+    now += kRtt;
+    bbr.on_congestion_event(inflight, now, acked, {});
+}
+
+class BbrAlgorithmTest : public testing::Test {
+public:
+    BbrAlgorithmTest()
+        :bbr_(bbr::profiles::kDefault, bbr::default_params::kInitCwnd,
+                bbr::default_params::kInitRtt, kStart)
+    {}
+
+    void run_round(size_t pkts)
+    {
+        ::run_round(bbr_, now_, next_seq_no_, pkts);
+    }
+
+    // Hibernates |bbr_| and wakes it up |times| times, a new instance each.
+    BbrHibernationState hibernate_and_wake_up(int times)
+    {
+        BbrHibernationState state = bbr_.hibernation_state();
+        for (int i = 0; i < times; i++) {
+            now_ += TimeDelta(1000 * 1000);
+            BbrAlgorithm woken(bbr::profiles::kDefault,
+                    bbr::default_params::kInitCwnd,
+                    bbr::default_params::kInitRtt, now_);
+            EXPECT_TRUE(woken.restore(state, now_));
+            state = woken.hibernation_state();
+        }
+        return state;
+    }
+protected:
+    BbrAlgorithm bbr_;
+    Timestamp now_ {kStart};
+    uint64_t next_seq_no_ = 1;
+};
+}
+
+TEST_F(BbrAlgorithmTest, HibernationKeepsEstimates)
+{
+    for (int i = 0; i < 20 && bbr_.mode() == BbrMode::STARTUP; i++) {
+        run_round(20);
+    }
+    ASSERT_NE(BbrMode::STARTUP, bbr_.mode());
+    ASSERT_GT(bbr_.model().max_bw(), 0_mbps);
+    const BbrHibernationState before = bbr_.hibernation_state();
+
+    BbrHibernationState after = hibernate_and_wake_up(2);
+    EXPECT_EQ(before.max_bw, after.max_bw);
+    EXPECT_EQ(before.min_rtt, after.min_rtt);
+    EXPECT_EQ(before.min_rtt_timestamp, after.min_rtt_timestamp);
+    EXPECT_EQ(before.inflight_hi, after.inflight_hi);
+    EXPECT_TRUE(after.full_bw_reached);
+}
+
+TEST_F(BbrAlgorithmTest, HibernationInStartupKeepsMinRtt)
+{
+    run_round(10);
+    ASSERT_EQ(BbrMode::STARTUP, bbr_.mode());
+    const BbrHibernationState before = bbr_.hibernation_state();
+    ASSERT_EQ(kRtt, before.min_rtt);
+
+    BbrHibernationState after = hibernate_and_wake_up(2);
+    EXPECT_EQ(before.max_bw, after.max_bw);
+    EXPECT_EQ(kRtt, after.min_rtt);
+    EXPECT_EQ(before.min_rtt_timestamp, after.min_rtt_timestamp);
+    EXPECT_FALSE(after.full_bw_reached);
+}
+
+TEST(BbrProfileTest, CompileTimeProfileMatchesRuntime)
+{
+    static_assert(bbr::internal::ProfileParams<bbr::profiles::LowLatency>::
+            get().min_rtt_sliding_window, "folded at compile time");
+
+    BbrAlgorithm runtime(bbr::profiles::kLowLatency,
+            bbr::default_params::kInitCwnd, bbr::default_params::kInitRtt,
+            kStart);
+    // The parameters passed are ignored.
+    bbr::BasicBbrAlgorithm<bbr::profiles::LowLatency> fixed(
+            bbr::profiles::kDefault, bbr::default_params::kInitCwnd,
+            bbr::default_params::kInitRtt, kStart);
+    EXPECT_TRUE(fixed.params().min_rtt_sliding_window);
+
+    Timestamp runtime_now = kStart;
+    Timestamp fixed_now = kStart;
+    uint64_t runtime_seq_no = 1;
+    uint64_t fixed_seq_no = 1;
+    for (int i = 0; i < 30; i++) {
+        run_round(runtime, runtime_now, runtime_seq_no, 20);
+        run_round(fixed, fixed_now, fixed_seq_no, 20);
+        EXPECT_EQ(runtime.mode(), fixed.mode());
+        EXPECT_EQ(runtime.cwnd(), fixed.cwnd());
+        EXPECT_EQ(runtime.pacing_rate(), fixed.pacing_rate());
+    }
+}
@@ -4,18 +4,20 @@
 
 namespace bbr
 {
-BbrDrainMode::BbrDrainMode(BbrAlgorithm* bbr,  BbrModel* model)
+template <typename Profile>
+BbrDrainMode<Profile>::BbrDrainMode(Algorithm* bbr, Model* model)
     :bbr_(bbr),
      model_(model)
 {
     ;
 }
 
-BbrMode BbrDrainMode::on_congestion_event(
+template <typename Profile>
+BbrMode BbrDrainMode<Profile>::on_congestion_event(
         size_t prior_inflight,
         time::Timestamp at_time,
-        const std::vector<AckedPacket>& acked_packets,
-        const std::vector<LostPacket>& lost_packets,
+        const std::vector<internal::AckedPacket>& acked_packets,
+        const std::vector<internal::LostPacket>& lost_packets,
         const BbrCongestionEvent& congestion_event)
 {
     model_->set_pacing_gain(bbr_->params().drain_pacing_gain);
@@ -30,14 +32,18 @@ BbrMode BbrDrainMode::on_congestion_event(
     return BbrMode::DRAIN;
 }
 
-size_t BbrDrainMode::cwnd_upper_limit() const
+template <typename Profile>
+size_t BbrDrainMode<Profile>::cwnd_upper_limit() const
 {
     return model_->inflight_lo();
 }
 
-size_t BbrDrainMode::drain_target() const
+template <typename Profile>
+size_t BbrDrainMode<Profile>::drain_target() const
 {
     size_t bdp = model_->bdp(model_->max_bw());
     return std::max(bdp, bbr_->min_cwnd());
 }
+
+BBR_INSTANTIATE_FOR_PROFILES(BbrDrainMode);
 }
@@ -9,13 +9,18 @@
 
 namespace bbr
 {
-class BbrAlgorithm;
-class BbrModel;
+template <typename Profile> class BasicBbrAlgorithm;
+template <typename Profile> class BasicBbrModel;
 struct BbrCongestionEvent;
+// Profile: see RuntimeProfile.
+template <typename Profile>
 class BbrDrainMode
 {
 public:
-    BbrDrainMode(BbrAlgorithm* bbr,  BbrModel* model);
+    using Algorithm = BasicBbrAlgorithm<Profile>;
+    using Model = BasicBbrModel<Profile>;
+
+    BbrDrainMode(Algorithm* bbr, Model* model);
 
     bool is_probing() const {
         return false;
@@ -25,8 +30,8 @@ public:
     BbrMode on_congestion_event(
         size_t prior_inflight,
         time::Timestamp at_time,
-        const std::vector<AckedPacket>& acked_packets,
-        const std::vector<LostPacket>& lost_packets,
+        const std::vector<internal::AckedPacket>& acked_packets,
+        const std::vector<internal::LostPacket>& lost_packets,
         const BbrCongestionEvent& congestion_event);
 
     void enter(time::Timestamp now,
@@ -43,8 +48,8 @@ private:
     size_t drain_target() const;
 
 private:
-    BbrAlgorithm* bbr_;
-    BbrModel* model_;
+    Algorithm* bbr_;
+    Model* model_;
 };
 
 }
@@ -0,0 +1,37 @@
+#ifndef BBR_HISTOGRAMS_H_
+#define BBR_HISTOGRAMS_H_
+
+#include <common/histogram.h>
+
+namespace bbr
+{
+// Distributions that BandwidthSampler/BbrSender would otherwise reduce to
+// a single min/max per ack event.
+// Not owned by the sender: one instance can be shared by all connections
+// driven by the same thread, or kept per connection and merged later.
+struct BbrHistograms
+{
+    // Per acked packet.
+    common::HdrHistogram rtt_us;
+    common::HdrHistogram bandwidth_bps;
+    // Per ack event.
+    common::HdrHistogram extra_acked_bytes;
+    // CPU time spent in BbrSender::on_pkt_ack/on_pkts_ack.
+    common::HdrHistogram ack_processing_ns;
+
+    void merge(const BbrHistograms& other) {
+        rtt_us.merge(other.rtt_us);
+        bandwidth_bps.merge(other.bandwidth_bps);
+        extra_acked_bytes.merge(other.extra_acked_bytes);
+        ack_processing_ns.merge(other.ack_processing_ns);
+    }
+
+    void reset() {
+        rtt_us.reset();
+        bandwidth_bps.reset();
+        extra_acked_bytes.reset();
+        ack_processing_ns.reset();
+    }
+};
+}
+#endif
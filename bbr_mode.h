@@ -18,6 +18,15 @@ enum class BbrMode : uint8_t {
     // the real minimum RTT.
     PROBE_RTT,
 };
+
+// Phases of a PROBE_BW cycle.
+enum class ProbeBwPhase : uint8_t {
+    kProbeNotStarted = 0,
+    kPorbeUp,
+    kPorbeDown,
+    kPorbeCruise,
+    kProbeRefill,
+};
 }
 
 #endif
@@ -20,13 +20,16 @@ void MinRttFilter::force_update(time::TimeDelta sample_rtt,
     min_rtt_timestamp_ = at_time;
 }
 
-BbrModel::BbrModel(const Bbrparams& bbr_params,
+template <typename Profile>
+BasicBbrModel<Profile>::BasicBbrModel(const Bbrparams& bbr_params,
         time::TimeDelta init_min_rtt,
         time::Timestamp init_min_rtt_timestamp,
-        float cwnd_gain,
-        float pacing_gain)
+        common::Gain cwnd_gain,
+        common::Gain pacing_gain)
     :params_(bbr_params),
      rtt_filter_(init_min_rtt, init_min_rtt_timestamp),
+     recent_min_rtt_(params().min_rtt_win,
+             time::TimeDelta::positive_infinity(), time::Timestamp()),
      cwnd_gain_(cwnd_gain),
      pacing_gain_(pacing_gain),
      latest_max_bw_(0_mbps),
@@ -34,10 +37,53 @@ BbrModel::BbrModel(const Bbrparams& bbr_params,
      inflight_lo_(kDefaultInflightBytes),
      inflight_hi_(kDefaultInflightBytes)
 {
-    ;
+    sampler_.set_use_receive_times(params().bw_sample_from_receive_times);
 }
 
-void BbrModel::on_pkt_sent(uint64_t seq_no, size_t pkt_size,
+template <typename Profile>
+void BasicBbrModel<Profile>::reset(time::TimeDelta init_min_rtt,
+        time::Timestamp init_min_rtt_timestamp,
+        common::Gain cwnd_gain,
+        common::Gain pacing_gain)
+{
+    cwnd_gain_ = cwnd_gain;
+    pacing_gain_ = pacing_gain;
+    rtt_filter_ = MinRttFilter(init_min_rtt, init_min_rtt_timestamp);
+    recent_min_rtt_ = MinRttWindowedFilter(params().min_rtt_win,
+            time::TimeDelta::positive_infinity(), time::Timestamp());
+    joined_probe_rtt_start_ = time::Timestamp();
+    smoothed_rtt_ = time::TimeDelta::positive_infinity();
+    latency_capped_ = false;
+    delay_gradient_.reset();
+    bandwidth_filter_ = MaxBandwidthFilter();
+    round_counter_ = RoundTripCounter();
+    sampler_.reset();
+
+    bytes_lost_in_round_ = 0;
+    lost_event_in_round_ = 0;
+    ecn_ce_in_round_ = 0;
+    pkts_acked_in_round_ = 0;
+    ecn_round_ended_ = false;
+    latest_max_bw_ = 0_mbps;
+    latest_max_infligth_bytes_ = 0;
+    bw_lo_ = common::BandWidth::positive_infinity();
+    inflight_lo_ = kDefaultInflightBytes;
+    inflight_hi_ = kDefaultInflightBytes;
+}
+
+template <typename Profile>
+void BasicBbrModel<Profile>::warm_start(common::BandWidth bw,
+        time::TimeDelta min_rtt,
+        size_t inflight_hi, time::Timestamp min_rtt_timestamp)
+{
+    rtt_filter_.force_update(min_rtt, min_rtt_timestamp);
+    recent_min_rtt_.reset(min_rtt, min_rtt_timestamp);
+    bandwidth_filter_.update(bw);
+    inflight_hi_ = inflight_hi;
+}
+
+template <typename Profile>
+void BasicBbrModel<Profile>::on_pkt_sent(uint64_t seq_no, size_t pkt_size,
         size_t infight_bytes, time::Timestamp at_time,
         bool need_retransmitted)
 {
@@ -46,7 +92,8 @@ void BbrModel::on_pkt_sent(uint64_t seq_no, size_t pkt_size,
             need_retransmitted);
 }
 
-void BbrModel::on_congestion_event(
+template <typename Profile>
+void BasicBbrModel<Profile>::on_congestion_event(
         const std::vector<internal::AckedPacket>& acked_pkts,
         const std::vector<internal::LostPacket>& lost_pkts,
         BbrCongestionEvent& congestion_event,
@@ -62,6 +109,13 @@ void BbrModel::on_congestion_event(
             round_counter_.on_pkt_acked(acked_pkts.rbegin()->seq_no);
     }
 
+    if(params().delay_gradient_enabled) {
+        for(const auto& pkt : acked_pkts) {
+            delay_gradient_.on_packet_acked(sampler_.pkt_sent_time(pkt.seq_no),
+                    pkt.receive_time);
+        }
+    }
+
     auto sample = sampler_.on_congestion_event(at_time, acked_pkts, lost_pkts,
             max_bw(), bw_lower_bound(), round_counter_.count());
     if (sample.last_packet_send_state.is_valid) {
@@ -85,7 +139,9 @@ void BbrModel::on_congestion_event(
 
     if (sample.sample_rtt.is_valid()) {
         congestion_event.sample_min_rtt = sample.sample_rtt;
-        rtt_filter_.update(congestion_event.sample_min_rtt, at_time);
+        congestion_event.rtt_sample_count = sample.sample_count;
+        update_min_rtt(congestion_event, at_time);
+        update_latency_cap(sample.sample_rtt);
     }
 
     congestion_event.bytes_acked = sampler_.total_bytes_acked() - prior_acked;
@@ -107,6 +163,18 @@ void BbrModel::on_congestion_event(
         lost_event_in_round_ ++;
     }
 
+    if(params().ecn_enabled) {
+        // The counts of a round are kept until the modes have checked them
+        // at its end, the round after starts from 0.
+        if(ecn_round_ended_) {
+            ecn_ce_in_round_ = 0;
+            pkts_acked_in_round_ = 0;
+        }
+        ecn_ce_in_round_ += congestion_event.ecn_ce_count;
+        pkts_acked_in_round_ += acked_pkts.size();
+        ecn_round_ended_ = congestion_event.end_of_round_trip;
+    }
+
     //latest_max_bw_\latest_max_infligth_bytes_ only increased within a round
     latest_max_bw_ = std::max(latest_max_bw_, sample.sample_max_bandwidth);
     latest_max_infligth_bytes_ = std::max(latest_max_infligth_bytes_,
@@ -127,49 +195,59 @@ void BbrModel::on_congestion_event(
     }
 }
 
-void BbrModel::end_congestion_event(
+template <typename Profile>
+void BasicBbrModel<Profile>::end_congestion_event(
         uint64_t least_unacked_pkt_no,
         const BbrCongestionEvent& congestion_event)
 {
     if (congestion_event.end_of_round_trip) {
         bytes_lost_in_round_ = 0;
         lost_event_in_round_ = 0;
+        ecn_ce_in_round_ = 0;
+        pkts_acked_in_round_ = 0;
     }
     sampler_.remove_obsolete_pkts(least_unacked_pkt_no);
 }
 
-void BbrModel::restart_round()
+template <typename Profile>
+void BasicBbrModel<Profile>::restart_round()
 {
     bytes_lost_in_round_ = 0;
     lost_event_in_round_ = 0;
+    ecn_ce_in_round_ = 0;
+    pkts_acked_in_round_ = 0;
     round_counter_.restart();
 }
 
-void BbrModel::adapt_lower_bounds(const BbrCongestionEvent& congestion_event)
+template <typename Profile>
+void BasicBbrModel<Profile>::adapt_lower_bounds(
+        const BbrCongestionEvent& congestion_event)
 {
     if(!congestion_event.end_of_round_trip
             || congestion_event.is_probing_for_bandwidth) {
         return;
     }
     //TODO:log bounds change
-    if(congestion_event.bytes_lost > 0)
+    if(congestion_event.bytes_lost > 0 || is_ecn_too_high())
     {
         if(!bw_lo_.is_valid()) {
             bw_lo_ = max_bw();
         }
-        bw_lo_ = std::max(latest_max_bw_, bw_lo_ * (1.0 - params_.beta));
-        if(params_.ignore_inflight_lo) {
+        bw_lo_ = std::max(latest_max_bw_, bw_lo_ * (common::Gain::one() - params().beta));
+        if(params().ignore_inflight_lo) {
             return;
         }
         if (inflight_lo_ == std::numeric_limits<size_t>::max()) {
             inflight_lo_ = congestion_event.prior_cwnd;
         }
         inflight_lo_ = std::max(latest_max_infligth_bytes_,
-                static_cast<size_t>(inflight_lo_ * (1.0 - params_.beta)));
+                inflight_lo_ * (common::Gain::one() - params().beta));
     }
 }
 
-bool BbrModel::is_inflight_too_high(const BbrCongestionEvent& congestion_event)
+template <typename Profile>
+bool BasicBbrModel<Profile>::is_inflight_too_high(
+        const BbrCongestionEvent& congestion_event)
 {
     const SendTimeState& send_state = congestion_event.last_packet_send_state;
     if(!send_state.is_valid) {
@@ -180,15 +258,25 @@ bool BbrModel::is_inflight_too_high(const BbrCongestionEvent& congestion_event)
 
     if(inflight_at_send > 0 && bytes_lost_in_round > 0) {
         size_t lost_in_round_threshold =
-            inflight_at_send * params_.loss_threshold;
+            inflight_at_send * params().loss_threshold;
         return bytes_lost_in_round > lost_in_round_threshold;
     }
     return false;
 }
 
-void BbrModel::cap_inflight_lo(size_t cap)
+template <typename Profile>
+bool BasicBbrModel<Profile>::is_ecn_too_high() const
+{
+    if(!params().ecn_enabled || ecn_ce_in_round_ == 0) {
+        return false;
+    }
+    return ecn_ce_in_round_ > pkts_acked_in_round_ * params().ecn_ce_threshold;
+}
+
+template <typename Profile>
+void BasicBbrModel<Profile>::cap_inflight_lo(size_t cap)
 {
-    if (params_.ignore_inflight_lo) {
+    if (params().ignore_inflight_lo) {
         return;
     }
 
@@ -197,36 +285,151 @@ void BbrModel::cap_inflight_lo(size_t cap)
     }
 }
 
-size_t BbrModel::inflight_hi_with_headroom() const
+template <typename Profile>
+size_t BasicBbrModel<Profile>::inflight_hi_with_headroom() const
 {
-    size_t headroom = inflight_hi_ * params_.inflight_hi_headroom_fraction;
+    size_t headroom = inflight_hi_ * params().inflight_hi_headroom_fraction;
 
     return inflight_hi_ > headroom ? inflight_hi_ - headroom : 0;
 }
 
-bool BbrModel::maybe_min_rtt_expired(const BbrCongestionEvent& congestion_event)
+template <typename Profile>
+void BasicBbrModel<Profile>::update_min_rtt(
+        const BbrCongestionEvent& congestion_event,
+        time::Timestamp at_time)
+{
+    const time::TimeDelta sample_rtt = congestion_event.sample_min_rtt;
+    if (!params().min_rtt_sliding_window) {
+        rtt_filter_.update(sample_rtt, at_time);
+        return;
+    }
+
+    recent_min_rtt_.update(sample_rtt, at_time);
+    // Only a sample sent with little in flight saw a drained queue and keeps
+    // min_rtt from expiring. Matching the windowed minimum is not enough: once
+    // the window moves past the last drained sample, a standing queue would
+    // refresh it forever.
+    bool low_rtt_sample = false;
+    if (congestion_event.last_packet_send_state.is_valid &&
+            max_bw() > 0_mbps) {
+        low_rtt_sample = bytes_inflight(congestion_event.last_packet_send_state)
+                <= bdp(max_bw(), params().probe_rtt_inflight_target_bdp_fraction);
+    }
+    rtt_filter_.force_update(recent_min_rtt_.get_best(),
+            low_rtt_sample ? at_time : rtt_filter_.timestamp());
+}
+
+template <typename Profile>
+bool BasicBbrModel<Profile>::maybe_min_rtt_expired(
+        const BbrCongestionEvent& congestion_event)
 {
     if(!rtt_filter_.timestamp().is_valid() || congestion_event.event_time <
-            rtt_filter_.timestamp() + params_.min_rtt_win) {
+            rtt_filter_.timestamp() + params().min_rtt_win) {
+        return false;
+    }
+    const time::Timestamp now = congestion_event.event_time;
+    time::TimeDelta path_min_rtt;
+    time::Timestamp path_min_rtt_timestamp;
+    // Another connection of the path probed more recently.
+    if (probe_rtt_coordinator_ &&
+            probe_rtt_coordinator_->min_rtt(path_min_rtt, path_min_rtt_timestamp) &&
+            path_min_rtt_timestamp > rtt_filter_.timestamp() &&
+            path_min_rtt_timestamp <= now &&
+            now - path_min_rtt_timestamp < params().min_rtt_win) {
+        adopt_min_rtt(path_min_rtt, path_min_rtt_timestamp);
         return false;
     }
     if( !congestion_event.sample_min_rtt.is_valid()) {
         return false;
     }
-    rtt_filter_.force_update(congestion_event.sample_min_rtt, congestion_event.event_time);
+    rtt_filter_.force_update(congestion_event.sample_min_rtt, now);
+    if (probe_rtt_coordinator_) {
+        joined_probe_rtt_start_ = probe_rtt_coordinator_->start_probe_rtt(now,
+                params().probe_rtt_duration);
+    }
+    return true;
+}
+
+template <typename Profile>
+bool BasicBbrModel<Profile>::path_probing_rtt(time::Timestamp now)
+{
+    if (!probe_rtt_coordinator_) {
+        return false;
+    }
+    time::Timestamp start = probe_rtt_coordinator_->probe_rtt_start();
+    if (!start.is_valid() || start == joined_probe_rtt_start_ || now < start ||
+            now - start >= params().probe_rtt_duration) {
+        return false;
+    }
+    joined_probe_rtt_start_ = start;
     return true;
 }
 
-bool BbrModel::cwnd_limited(const BbrCongestionEvent& congestion_event) const
+template <typename Profile>
+void BasicBbrModel<Profile>::on_probe_rtt_done(time::Timestamp now)
+{
+    if (!probe_rtt_coordinator_) {
+        return;
+    }
+    probe_rtt_coordinator_->report_min_rtt(min_rtt(), now);
+
+    time::TimeDelta path_min_rtt;
+    time::Timestamp path_min_rtt_timestamp;
+    if (probe_rtt_coordinator_->min_rtt(path_min_rtt, path_min_rtt_timestamp) &&
+            joined_probe_rtt_start_.is_valid() &&
+            path_min_rtt_timestamp >= joined_probe_rtt_start_ &&
+            path_min_rtt < min_rtt()) {
+        adopt_min_rtt(path_min_rtt, path_min_rtt_timestamp);
+    }
+}
+
+template <typename Profile>
+void BasicBbrModel<Profile>::adopt_min_rtt(time::TimeDelta min_rtt,
+        time::Timestamp at_time)
+{
+    rtt_filter_.force_update(min_rtt, at_time);
+    if (params().min_rtt_sliding_window) {
+        recent_min_rtt_.reset(min_rtt, at_time);
+    }
+}
+
+template <typename Profile>
+void BasicBbrModel<Profile>::update_latency_cap(time::TimeDelta sample_rtt)
+{
+    if (!smoothed_rtt_.is_valid()) {
+        smoothed_rtt_ = sample_rtt;
+    } else {
+        smoothed_rtt_ = smoothed_rtt_ * common::Gain(7.0 / 8) +
+                sample_rtt * common::Gain(1.0 / 8);
+    }
+    if (!params().max_queueing_delay.is_valid()) {
+        return;
+    }
+    time::TimeDelta queueing_delay = smoothed_rtt_ > min_rtt() ?
+            smoothed_rtt_ - min_rtt() : time::TimeDelta(0);
+    if (queueing_delay > params().max_queueing_delay) {
+        latency_capped_ = true;
+    } else if (queueing_delay <= params().max_queueing_delay / 2) {
+        latency_capped_ = false;
+    }
+}
+
+template <typename Profile>
+bool BasicBbrModel<Profile>::cwnd_limited(
+        const BbrCongestionEvent& congestion_event) const
 {
     size_t prior_bytes_in_flight = congestion_event.bytes_in_flight +
                 congestion_event.bytes_acked + congestion_event.bytes_lost;
     return prior_bytes_in_flight >= congestion_event.prior_cwnd;
 }
 
-void BbrModel::postpone_min_rtt_timestamp(time::TimeDelta duration)
+template <typename Profile>
+void BasicBbrModel<Profile>::postpone_min_rtt_timestamp(
+        time::TimeDelta duration)
 {
     rtt_filter_.force_update(min_rtt(), rtt_filter_.timestamp() + duration);
 }
 
+
+BBR_INSTANTIATE_FOR_PROFILES(BasicBbrModel);
 }
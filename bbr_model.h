@@ -3,6 +3,12 @@
 
 #include <bandwidth_sampler.h>
 #include <round_trip_counter.h>
+#include <delay_gradient_estimator.h>
+#include <common/gain.h>
+#include <common/windowed_filter.h>
+#include <probe_rtt_coordinator.h>
+#include <bbr_observer.h>
+#include <bbr_profiles.h>
 
 namespace bbr
 {
@@ -50,71 +56,6 @@ private:
     common::BandWidth max_bw_[2] = {{0}, {0}};
 };
 
-struct Bbrparams
-{
-    // A common factor for multiplicative decreases. Used for adjusting
-    // bandwidth_lo, inflight_lo and inflight_hi upon losses.
-    float beta = 0.3;
-
-    bool ignore_inflight_lo = false;
-
-    // Full bandwidth is declared if the total bandwidth growth is less than
-    // |startup_full_bw_threshold| times in the last |startup_full_bw_rounds|
-    // round trips.
-    float startup_full_bw_threshold = 1.25;
-
-    uint64_t startup_full_bw_rounds = 3;
-
-    uint8_t startup_full_loss_count = 8; //tcp_bbr2.c
-
-    uint8_t probe_bw_full_loss_count = 2; //quic-bbr2
-
-    float loss_threshold = 0.02; //tcp_bbr2.c
-
-    float startup_cwnd_gain = 2.885;
-    float startup_pacing_gain = 2.885;
-
-    float drain_cwnd_gain = 2.885;
-    float drain_pacing_gain = 1.0 / 2.885;
-
-    //probe bandwidth gains
-    //cwnd gains
-    float probe_bw_cwnd_gain = 2.0;
-
-    // Multiplier to get target inflight (as multiple of BDP) for PROBE_UP phase.
-    float probe_bw_probe_inflight_gain = 1.25;
-
-    // Pacing gains.
-    float probe_bw_probe_up_pacing_gain = 1.25;
-    float probe_bw_probe_down_pacing_gain = 0.75;
-    float probe_bw_default_pacing_gain = 1.0;
-
-    //amount of randomness to inject in round counting for Reno-coexistence.
-    uint8_t bw_probe_rand_rounds = 2; //tcp_bbr2.c
-    uint32_t bbr_bw_probe_base_us = 2 * 1000 * 1000; // 2 sec tcp_bbr2.c
-    uint32_t bbr_bw_probe_rand_us = 1 * 1000 * 1000; //1 sec tcp_bbr2.c
-
-    bool limit_inflight_hi_by_cwnd = false;
-
-    float inflight_hi_headroom_fraction = 0.01; //tcp_bbr2:15%, quic_bbr2: 1%
-
-    time::TimeDelta min_rtt_win {10 * 1000 * 1000};
-
-    const static size_t kDefaultTCPMSS = 1460;
-
-    uint8_t probe_bw_probe_max_rounds = 63;
-
-    // Multiplier to get Reno-style probe epoch duration as: k * BDP round trips.
-    // If zero, disables Reno-style BDP-scaled coexistence mechanism.
-    float probe_bw_probe_reno_gain = 1.0;
-
-    //probe rtt:200ms
-    time::TimeDelta probe_rtt_duration {200 * 1000};
-    float probe_rtt_inflight_target_bdp_fraction = 0.5;
-
-    size_t min_cwnd = 4 * kDefaultTCPMSS;
-};
-
 // Information that are meaningful only when Bbr2Sender::OnCongestionEvent is
 // running.
 struct BbrCongestionEvent
@@ -134,6 +75,9 @@ struct BbrCongestionEvent
     // Total bytes lost from losses in this event.
     size_t bytes_lost = 0;
 
+    // Acked packets of this event which arrived ECN-CE marked.
+    size_t ecn_ce_count = 0;
+
     // Whether acked_packets indicates the end of a round trip.
     bool end_of_round_trip = false;
 
@@ -150,6 +94,9 @@ struct BbrCongestionEvent
     // QuicTime::Delta::Infinite() if acked_packets is empty.
     time::TimeDelta sample_min_rtt;
 
+    // Number of rtt samples |sample_min_rtt| is the minimum of.
+    size_t rtt_sample_count = 0;
+
     // Maximum bandwidth of all bandwidth samples from acked_packets.
     common::BandWidth sample_max_bandwidth;
 
@@ -161,16 +108,32 @@ struct BbrCongestionEvent
     time::Timestamp event_time;
 };
 
-class BbrModel
+// Profile: see RuntimeProfile.
+template <typename Profile = RuntimeProfile>
+class BasicBbrModel
 {
 public:
     const static size_t kDefaultInflightBytes = std::numeric_limits<size_t>::max();
 public:
-    BbrModel(const Bbrparams& bbr_params,
+    BasicBbrModel(const Bbrparams& bbr_params,
             time::TimeDelta init_min_rtt,
             time::Timestamp init_min_rtt_timestamp,
-            float cwnd_gain,
-            float pacing_gain);
+            common::Gain cwnd_gain,
+            common::Gain pacing_gain);
+
+    // Back to the state of a new connection, see BbrAlgorithm::reset().
+    void reset(time::TimeDelta init_min_rtt,
+            time::Timestamp init_min_rtt_timestamp,
+            common::Gain cwnd_gain,
+            common::Gain pacing_gain);
+
+    // Seeds the estimates of a connection which has not sent anything yet,
+    // see BbrAlgorithm::warm_start() and BbrAlgorithm::restore().
+    void warm_start(common::BandWidth bw, time::TimeDelta min_rtt,
+            size_t inflight_hi, time::Timestamp min_rtt_timestamp);
+
+    // See BandwidthSampler::release_memory().
+    void release_memory() { sampler_.release_memory();}
 
     void on_pkt_sent(uint64_t seq_no, size_t pkt_size, size_t infight_bytes,
             time::Timestamp at_time, bool need_retransmitted);
@@ -186,15 +149,44 @@ public:
 
     bool is_inflight_too_high( const BbrCongestionEvent& congestion_event);
 
+    // More than ecn_ce_threshold of the packets acked in the round were
+    // ECN-CE marked, always false unless ecn_enabled.
+    bool is_ecn_too_high() const;
+
     bool maybe_min_rtt_expired(const BbrCongestionEvent& congestion_event);
 
+    // Synchronizes PROBE_RTT with the other connections of the path.
+    // Not owned, nullptr(default) probes alone.
+    void set_probe_rtt_coordinator(ProbeRttCoordinator* coordinator) {
+        probe_rtt_coordinator_ = coordinator;
+    }
+
+    // Another connection of the path started a PROBE_RTT which this one
+    // should join.
+    bool path_probing_rtt(time::Timestamp now);
+
+    // Shares the min rtt measured in PROBE_RTT with the path, and takes a
+    // lower one measured by another connection in the same PROBE_RTT.
+    void on_probe_rtt_done(time::Timestamp now);
+
     time::TimeDelta min_rtt() const { return rtt_filter_.min_rtt();}
 
+    time::Timestamp min_rtt_timestamp() const { return rtt_filter_.timestamp();}
+
+    // RFC 6298 style average of the rtt samples, infinite before the first.
+    time::TimeDelta smoothed_rtt() const { return smoothed_rtt_;}
+
+    // See Bbrparams::max_queueing_delay.
+    bool latency_capped() const { return latency_capped_;}
+
+    // Always kNormal unless Bbrparams::delay_gradient_enabled.
+    DelayTrend delay_trend() const { return delay_gradient_.trend();}
+
     common::BandWidth max_bw() const{ return bandwidth_filter_.get();}
 
     common::BandWidth estimated_bw() const { return std::min(max_bw(), bw_lo_);}
 
-    size_t bdp(common::BandWidth bw, float gain = 1.0) const
+    size_t bdp(common::BandWidth bw, common::Gain gain = common::Gain::one()) const
     {
         return bw * (min_rtt() * gain);
     }
@@ -203,6 +195,8 @@ public:
 
     size_t loss_events_in_round() const{ return lost_event_in_round_;}
 
+    size_t ecn_ce_in_round() const{ return ecn_ce_in_round_;}
+
     size_t inflight_lo() const { return inflight_lo_;}
 
     size_t inflight_hi() const { return inflight_hi_;}
@@ -211,11 +205,35 @@ public:
 
     bool cwnd_limited( const BbrCongestionEvent& congestion_event) const;
 
+    size_t total_bytes_sent() const { return sampler_.total_bytes_sent();}
+
     size_t total_bytes_acked() const { return sampler_.total_bytes_acked();}
 
+    size_t total_bytes_lost() const { return sampler_.total_bytes_lost();}
+
     size_t max_ack_hegith() const { return sampler_.max_ack_height();}
+
+    void set_histograms(BbrHistograms* histograms) {
+        sampler_.set_histograms(histograms);
+    }
+
+    void set_sent_packets(SentPacketTable* sent_pkts) {
+        sampler_.set_sent_packets(sent_pkts);
+    }
+
+    // See BbrTransitionSink, not owned, nullptr when nobody listens.
+    void set_transition_sink(internal::BbrTransitionSink* sink) {
+        transition_sink_ = sink;
+    }
+
+    internal::BbrTransitionSink* transition_sink() const { return transition_sink_;}
 public:
-    void set_inflight_hi(size_t inflight_hi){ inflight_hi_ = inflight_hi;}
+    void set_inflight_hi(size_t inflight_hi) {
+        if (transition_sink_ != nullptr && inflight_hi != inflight_hi_) {
+            transition_sink_->on_inflight_hi_changed(inflight_hi_, inflight_hi);
+        }
+        inflight_hi_ = inflight_hi;
+    }
 
     void cap_inflight_lo(size_t cap);
 
@@ -225,22 +243,43 @@ public:
 
     void restart_round();
 
-    void set_pacing_gain(float gain) { pacing_gain_ = gain;}
-    void set_cwnd_gain(float gain) { cwnd_gain_ = gain;}
+    void set_pacing_gain(common::Gain gain) { pacing_gain_ = gain;}
+    void set_cwnd_gain(common::Gain gain) { cwnd_gain_ = gain;}
     void advance_bw_hi_filter() { bandwidth_filter_.advance();}
 
-    float pacing_gain() const { return pacing_gain_;}
-    float cwnd_gain() const { return cwnd_gain_;}
+    common::Gain pacing_gain() const { return pacing_gain_;}
+    common::Gain cwnd_gain() const { return cwnd_gain_;}
 
 private:
+    const Bbrparams& params() const { return params_.get();}
+
     void adapt_lower_bounds(const BbrCongestionEvent& congestion_event);
+    void update_min_rtt(const BbrCongestionEvent& congestion_event,
+            time::Timestamp at_time);
+    void adopt_min_rtt(time::TimeDelta min_rtt, time::Timestamp at_time);
+    void update_latency_cap(time::TimeDelta sample_rtt);
 
 private:
-    Bbrparams params_;
-    float cwnd_gain_;
-    float pacing_gain_;
+    internal::ProfileParams<Profile> params_;
 
     MinRttFilter rtt_filter_;
+    // See Bbrparams::min_rtt_sliding_window.
+    using MinRttWindowedFilter = WindowedFilter<time::TimeDelta,
+            MinFilter<time::TimeDelta>, time::Timestamp, time::TimeDelta>;
+    MinRttWindowedFilter recent_min_rtt_;
+
+    common::Gain cwnd_gain_;
+    common::Gain pacing_gain_;
+
+    time::TimeDelta smoothed_rtt_;
+    bool latency_capped_ = false;
+
+    DelayGradientEstimator delay_gradient_;
+
+    ProbeRttCoordinator* probe_rtt_coordinator_ = nullptr;
+    internal::BbrTransitionSink* transition_sink_ = nullptr;
+    // Start of the path wide PROBE_RTT this connection took part in last.
+    time::Timestamp joined_probe_rtt_start_;
     //The filter that tracks the maximum bandwidth over
     //multiple recent round trips.
     MaxBandwidthFilter bandwidth_filter_;
@@ -250,6 +289,10 @@ private:
 
     size_t bytes_lost_in_round_ = 0;
     size_t lost_event_in_round_ = 0;
+    size_t ecn_ce_in_round_ = 0;
+    size_t pkts_acked_in_round_ = 0;
+    // The last event ended a round, the ECN counts are stale.
+    bool ecn_round_ended_ = false;
 
     // Max bandwidth in the current round. Updated once per congestion event.
     common::BandWidth latest_max_bw_;
@@ -263,6 +306,8 @@ private:
     size_t inflight_hi_;
 };
 
+using BbrModel = BasicBbrModel<>;
+
 inline size_t bytes_inflight( const SendTimeState& send_state)
 {
     if (send_state.bytes_in_flight != 0) {
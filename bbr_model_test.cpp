@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <bbr_model.h>
+
+using BbrModel = bbr::BbrModel;
+using BbrCongestionEvent = bbr::BbrCongestionEvent;
+using namespace bbr::time;
+
+namespace
+{
+const size_t kPktSize = 1200;
+const TimeDelta kRtt(20 * 1000);
+
+bbr::Bbrparams ecn_params()
+{
+    bbr::Bbrparams params;
+    params.ecn_enabled = true;
+    return params;
+}
+
+class BbrModelTest : public testing::Test {
+public:
+    BbrModelTest()
+        :params_(ecn_params()),
+         model_(params_, kRtt, Timestamp(0), bbr::common::Gain::one(),
+                 bbr::common::Gain::one())
+    {}
+
+    // Sends |pkts| packets and acks them all in one event one rtt later,
+    // |ecn_ce_count| of them ECN-CE marked.
+    BbrCongestionEvent run_round(size_t pkts, size_t ecn_ce_count)
+    {
+        std::vector<bbr::internal::AckedPacket> acked;
+        size_t inflight = 0;
+        for (size_t i = 0; i < pkts; i++) {
+            model_.on_pkt_sent(next_seq_no_, kPktSize, inflight, now_, true);
+            acked.push_back({next_seq_no_, kPktSize, now_ + kRtt / 2});
+            next_seq_no_++;
+            inflight += kPktSize;
+        }
+        now_ += kRtt;
+        BbrCongestionEvent congestion_event;
+        congestion_event.prior_bytes_in_flight = inflight;
+        congestion_event.ecn_ce_count = ecn_ce_count;
+        model_.on_congestion_event(acked, {}, congestion_event, now_);
+        return congestion_event;
+    }
+protected:
+    bbr::Bbrparams params_;
+    BbrModel model_;
+    Timestamp now_ {0};
+    uint64_t next_seq_no_ = 1;
+};
+}
+
+TEST_F(BbrModelTest, EcnCountsOnlyTheLastRound)
+{
+    EXPECT_TRUE(run_round(10, 10).end_of_round_trip);
+    EXPECT_TRUE(model_.is_ecn_too_high());
+
+    // 10 marks out of the 14 packets of both rounds would still be too many.
+    EXPECT_TRUE(run_round(4, 0).end_of_round_trip);
+    EXPECT_EQ(0u, model_.ecn_ce_in_round());
+    EXPECT_FALSE(model_.is_ecn_too_high());
+}
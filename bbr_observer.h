@@ -0,0 +1,79 @@
+#ifndef BBR_OBSERVER_H_
+#define BBR_OBSERVER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <common/rate.h>
+#include <time/timestamp.h>
+#include <bbr_mode.h>
+
+namespace bbr
+{
+// Observer policy of BbrAlgorithm, resolved at compile time.
+// To receive events, derive from NullBbrObserver, set kEnabled to true and
+// hide the callbacks of interest. With kEnabled == false the state
+// snapshots and the calls are compiled out entirely.
+struct NullBbrObserver
+{
+    static constexpr bool kEnabled = false;
+
+    void on_mode_leave(BbrMode /*mode*/, time::Timestamp /*now*/) {}
+
+    void on_mode_enter(BbrMode /*mode*/, time::Timestamp /*now*/) {}
+
+    // Reported at every change of the PROBE_BW phase, also those undone
+    // within the same congestion event.
+    void on_probe_phase_changed(ProbeBwPhase /*from*/, ProbeBwPhase /*to*/,
+            time::Timestamp /*now*/) {}
+
+    // STARTUP found the bottleneck bandwidth (or gave up due to losses).
+    // Reported at the end of the congestion event.
+    void on_full_bw_reached(common::BandWidth /*max_bw*/,
+            time::Timestamp /*now*/) {}
+
+    void on_inflight_hi_changed(size_t /*prior_inflight_hi*/,
+            size_t /*inflight_hi*/, time::Timestamp /*now*/) {}
+};
+
+namespace internal
+{
+// Where the modes and BbrModel report transitions as they make them.
+// BbrAlgorithm installs one only for the duration of an event with an
+// enabled observer, so a disabled observer costs a null check per
+// transition.
+class BbrTransitionSink
+{
+public:
+    virtual ~BbrTransitionSink() = default;
+
+    virtual void on_probe_phase_changed(ProbeBwPhase from, ProbeBwPhase to) = 0;
+
+    virtual void on_inflight_hi_changed(size_t prior_inflight_hi,
+            size_t inflight_hi) = 0;
+};
+
+// Forwards to an observer, with the time of the event.
+template <typename Observer>
+class ObserverTransitionSink : public BbrTransitionSink
+{
+public:
+    ObserverTransitionSink(Observer& observer, time::Timestamp now)
+        : observer_(observer), now_(now)
+    {}
+
+    void on_probe_phase_changed(ProbeBwPhase from, ProbeBwPhase to) override {
+        observer_.on_probe_phase_changed(from, to, now_);
+    }
+
+    void on_inflight_hi_changed(size_t prior_inflight_hi,
+            size_t inflight_hi) override {
+        observer_.on_inflight_hi_changed(prior_inflight_hi, inflight_hi, now_);
+    }
+
+private:
+    Observer& observer_;
+    time::Timestamp now_;
+};
+}
+}
+#endif
@@ -0,0 +1,133 @@
+#ifndef BBR_PARAMS_H_
+#define BBR_PARAMS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <common/gain.h>
+#include <time/timestamp.h>
+
+namespace bbr
+{
+struct Bbrparams
+{
+    // A common factor for multiplicative decreases. Used for adjusting
+    // bandwidth_lo, inflight_lo and inflight_hi upon losses.
+    common::Gain beta {0.3};
+
+    bool ignore_inflight_lo = false;
+
+    // Full bandwidth is declared if the total bandwidth growth is less than
+    // |startup_full_bw_threshold| times in the last |startup_full_bw_rounds|
+    // round trips.
+    common::Gain startup_full_bw_threshold {1.25};
+
+    uint64_t startup_full_bw_rounds = 3;
+
+    uint8_t startup_full_loss_count = 8; //tcp_bbr2.c
+
+    // Delay based STARTUP exit (HyStart++, RFC 9406): full bandwidth is also
+    // declared once the min rtt of the current round, after at least
+    // |startup_rtt_sample_count| samples, exceeds the min rtt of the previous
+    // round by |startup_rtt_thresh_fraction| of it, clamped to
+    // [startup_min_rtt_thresh, startup_max_rtt_thresh].
+    bool startup_exit_on_rtt_increase = false;
+    uint32_t startup_rtt_sample_count = 8;
+    common::Gain startup_rtt_thresh_fraction {1.0 / 8};
+    time::TimeDelta startup_min_rtt_thresh {4 * 1000};
+    time::TimeDelta startup_max_rtt_thresh {16 * 1000};
+
+    // Check the STARTUP exit criteria (rtt increase, losses) on every
+    // congestion event against the current, partial round instead of only
+    // at the end of each round.
+    bool startup_rolling_round_check = false;
+
+    uint8_t probe_bw_full_loss_count = 2; //quic-bbr2
+
+    common::Gain loss_threshold {0.02}; //tcp_bbr2.c
+
+    // React to ECN-CE marks (L4S style, e.g. ECN enabled switches of a data
+    // center marking at a shallow queue), not only to losses, which need a
+    // full queue first. A round in which more than |ecn_ce_threshold| of the
+    // acked packets were marked lowers bw_lo/inflight_lo like a lossy round,
+    // ends PROBE_UP lowering inflight_hi, and ends STARTUP.
+    bool ecn_enabled = false;
+    common::Gain ecn_ce_threshold {0.5};
+
+    // Track the one-way delay gradient from the receive times the peer
+    // reports, see DelayGradientEstimator. A growing queue (overusing)
+    // ends STARTUP and PROBE_UP before the rtt or losses react.
+    bool delay_gradient_enabled = false;
+
+    // Bandwidth samples from the peer's receive times rather than the ack
+    // arrival times, immune to ack compression, see
+    // BandwidthSampler::set_use_receive_times().
+    bool bw_sample_from_receive_times = false;
+
+    common::Gain startup_cwnd_gain {2.885};
+    common::Gain startup_pacing_gain {2.885};
+
+    common::Gain drain_cwnd_gain {2.885};
+    common::Gain drain_pacing_gain {1.0 / 2.885};
+
+    //probe bandwidth gains
+    //cwnd gains
+    common::Gain probe_bw_cwnd_gain {2.0};
+
+    // Multiplier to get target inflight (as multiple of BDP) for PROBE_UP phase.
+    common::Gain probe_bw_probe_inflight_gain {1.25};
+
+    // Pacing gains.
+    common::Gain probe_bw_probe_up_pacing_gain {1.25};
+    common::Gain probe_bw_probe_down_pacing_gain {0.75};
+    common::Gain probe_bw_default_pacing_gain {1.0};
+
+    //amount of randomness to inject in round counting for Reno-coexistence.
+    uint8_t bw_probe_rand_rounds = 2; //tcp_bbr2.c
+    uint32_t bbr_bw_probe_base_us = 2 * 1000 * 1000; // 2 sec tcp_bbr2.c
+    uint32_t bbr_bw_probe_rand_us = 1 * 1000 * 1000; //1 sec tcp_bbr2.c
+
+    bool limit_inflight_hi_by_cwnd = false;
+
+    common::Gain inflight_hi_headroom_fraction {0.01}; //tcp_bbr2:15%, quic_bbr2: 1%
+
+    time::TimeDelta min_rtt_win {10 * 1000 * 1000};
+
+    // min_rtt is the minimum of a sliding |min_rtt_win| window instead of
+    // a single sample, and only expires (entering PROBE_RTT) if no low rtt
+    // sample was seen in the window: one sent with at most
+    // probe_rtt_inflight_target_bdp_fraction * BDP in flight, which is as
+    // drained as PROBE_RTT would make it.
+    bool min_rtt_sliding_window = false;
+
+    const static size_t kDefaultTCPMSS = 1460;
+
+    uint8_t probe_bw_probe_max_rounds = 63;
+
+    // Multiplier to get Reno-style probe epoch duration as: k * BDP round trips.
+    // If zero, disables Reno-style BDP-scaled coexistence mechanism.
+    common::Gain probe_bw_probe_reno_gain {1.0};
+
+    //probe rtt:200ms
+    time::TimeDelta probe_rtt_duration {200 * 1000};
+    common::Gain probe_rtt_inflight_target_bdp_fraction {0.5};
+
+    size_t min_cwnd = 4 * kDefaultTCPMSS;
+
+    // Latency capped sending, for real-time media. While the smoothed rtt
+    // exceeds min_rtt by more than |max_queueing_delay|, inflight is capped
+    // at bdp(estimated_bw) plus |latency_cap_headroom| of it and the pacing
+    // gain at |latency_cap_pacing_gain|, PROBE_UP and STARTUP included; no
+    // new bandwidth probe starts. It ends once the queueing delay is back
+    // under half the target. Infinite(default) disables it.
+    time::TimeDelta max_queueing_delay {time::TimeDelta::positive_infinity()};
+    common::Gain latency_cap_headroom {0.05};
+    common::Gain latency_cap_pacing_gain {0.9};
+
+    // Warm start from a PathCache (careful resume): only this fraction of
+    // the cached max_bw is assumed, PROBE_BW probes for the rest.
+    common::Gain resume_bw_fraction {0.5};
+    // Older cache entries are ignored.
+    time::TimeDelta resume_max_age {600 * 1000 * 1000};
+};
+}
+#endif
@@ -4,14 +4,16 @@
 
 namespace bbr
 {
-BbrProbeBandwidth::BbrProbeBandwidth(BbrAlgorithm* bbr,  BbrModel* model)
+template <typename Profile>
+BbrProbeBandwidth<Profile>::BbrProbeBandwidth(Algorithm* bbr, Model* model)
     :bbr_(bbr),
      model_(model)
 {
     ;
 }
 
-void BbrProbeBandwidth::enter(time::Timestamp now,
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::enter(time::Timestamp now,
            const BbrCongestionEvent* congestion_event)
 {
     if (cycle_.phase == CyclePhase::kProbeNotStarted) {
@@ -28,10 +30,11 @@ void BbrProbeBandwidth::enter(time::Timestamp now,
     }
 }
 
-BbrMode BbrProbeBandwidth::on_congestion_event(
+template <typename Profile>
+BbrMode BbrProbeBandwidth<Profile>::on_congestion_event(
     size_t prior_inflight, time::Timestamp at_time,
-    const std::vector<AckedPacket>& acked_packets,
-    const std::vector<LostPacket>& lost_packets,
+    const std::vector<internal::AckedPacket>& acked_packets,
+    const std::vector<internal::LostPacket>& lost_packets,
     const BbrCongestionEvent& congestion_event)
 {
     if (congestion_event.end_of_round_trip) {
@@ -65,6 +68,11 @@ BbrMode BbrProbeBandwidth::on_congestion_event(
         break;
     }
 
+    // Drain together with the other connections of the path.
+    if (!switch_to_probe_rtt && model_->path_probing_rtt(at_time)) {
+        switch_to_probe_rtt = true;
+    }
+
     // Do not need to set the gains if switching to PROBE_RTT, they will be set
     // when BbrProbeRttMode::Enter is called.
     if (!switch_to_probe_rtt) {
@@ -76,7 +84,8 @@ BbrMode BbrProbeBandwidth::on_congestion_event(
 }
 
 
-BbrMode BbrProbeBandwidth::on_exit_quiescence(
+template <typename Profile>
+BbrMode BbrProbeBandwidth<Profile>::on_exit_quiescence(
         time::Timestamp quiescence_start_time,
         time::Timestamp now)
 {
@@ -84,29 +93,41 @@ BbrMode BbrProbeBandwidth::on_exit_quiescence(
     return BbrMode::PROBE_BW;
 }
 
-void BbrProbeBandwidth::enter_probe_down(bool probed_too_high,
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::enter_probe_down(bool probed_too_high,
         bool stopped_risky_probe, time::Timestamp now)
 {
     last_cycle_probed_too_high_ = probed_too_high;
     last_cycle_stopped_risky_probe_ = stopped_risky_probe;
 
     cycle_.cycle_start_time = now;
-    cycle_.phase = CyclePhase::kPorbeDown;
+    set_phase(CyclePhase::kPorbeDown);
     cycle_.rounds_in_phase = 0;
     cycle_.phase_start_time = now;
 
     //bbr2_pick_probe_wait
-    cycle_.rounds_since_probe = bbr_->random().rand<uint32_t>() %
+    cycle_.rounds_since_probe = bbr_->random().template rand<uint32_t>() %
             bbr_->params().bw_probe_rand_rounds;
     cycle_.probe_wait_time = bbr_->params().bbr_bw_probe_base_us +
-            bbr_->random().rand<uint32_t>() % bbr_->params().bbr_bw_probe_rand_us;
+            bbr_->random().template rand<uint32_t>() % bbr_->params().bbr_bw_probe_rand_us;
 
     cycle_.probe_up_bytes = std::numeric_limits<size_t>::max();
     cycle_.has_advanced_max_bw = false;
     model_->restart_round();
 }
 
-void BbrProbeBandwidth::exist_probe_down()
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::set_phase(CyclePhase phase)
+{
+    internal::BbrTransitionSink* sink = model_->transition_sink();
+    if (sink != nullptr && phase != cycle_.phase) {
+        sink->on_probe_phase_changed(cycle_.phase, phase);
+    }
+    cycle_.phase = phase;
+}
+
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::exist_probe_down()
 {
     if (!cycle_.has_advanced_max_bw) {
         model_->advance_bw_hi_filter();
@@ -114,9 +135,10 @@ void BbrProbeBandwidth::exist_probe_down()
     }
 }
 
-void BbrProbeBandwidth::enter_probe_up(time::Timestamp now)
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::enter_probe_up(time::Timestamp now)
 {
-    cycle_.phase = CyclePhase::kPorbeUp;
+    set_phase(CyclePhase::kPorbeUp);
     cycle_.rounds_in_phase = 0;
     cycle_.phase_start_time = now;
     cycle_.is_sample_from_probing = true;
@@ -124,25 +146,27 @@ void BbrProbeBandwidth::enter_probe_up(time::Timestamp now)
     model_->restart_round();
 }
 
-void BbrProbeBandwidth::enter_probe_cruise(time::Timestamp now)
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::enter_probe_cruise(time::Timestamp now)
 {
     if(cycle_.phase == CyclePhase::kPorbeDown) {
         exist_probe_down();
     }
     model_->cap_inflight_lo(model_->inflight_hi());
-    cycle_.phase = CyclePhase::kPorbeCruise;
+    set_phase(CyclePhase::kPorbeCruise);
     cycle_.rounds_in_phase = 0;
     cycle_.phase_start_time = now;
     cycle_.is_sample_from_probing = false;
 }
 
-void BbrProbeBandwidth::enter_probe_refill(uint64_t probe_up_rounds,
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::enter_probe_refill(uint64_t probe_up_rounds,
         time::Timestamp now)
 {
     if(cycle_.phase == CyclePhase::kPorbeDown) {
         exist_probe_down();
     }
-    cycle_.phase = CyclePhase::kProbeRefill;
+    set_phase(CyclePhase::kProbeRefill);
     cycle_.rounds_in_phase = 0;
     cycle_.phase_start_time = now;
     cycle_.is_sample_from_probing = false;
@@ -155,7 +179,8 @@ void BbrProbeBandwidth::enter_probe_refill(uint64_t probe_up_rounds,
     model_->restart_round();
 }
 
-void BbrProbeBandwidth::raise_inflight_hi()
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::raise_inflight_hi()
 {
     uint64_t growth_this_round = 1 << cycle_.probe_up_rounds;
     cycle_.probe_up_rounds = std::min<uint64_t>(cycle_.probe_up_rounds + 1, 30);
@@ -165,7 +190,8 @@ void BbrProbeBandwidth::raise_inflight_hi()
         std::max<size_t>(probe_up_bytes, Bbrparams::kDefaultTCPMSS);
 }
 
-void BbrProbeBandwidth::update_probe_down(size_t prior_inflight,
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::update_probe_down(size_t prior_inflight,
         const BbrCongestionEvent& congestion_event)
 {
     if (cycle_.rounds_in_phase == 1 && congestion_event.end_of_round_trip) {
@@ -216,7 +242,8 @@ void BbrProbeBandwidth::update_probe_down(size_t prior_inflight,
     }
 }
 
-void BbrProbeBandwidth::update_probe_up(size_t prior_inflight,
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::update_probe_up(size_t prior_inflight,
         const BbrCongestionEvent& congestion_event)
 {
     if (maybe_adapt_upper_bounds(congestion_event) ==
@@ -234,6 +261,9 @@ void BbrProbeBandwidth::update_probe_up(size_t prior_inflight,
     if (last_cycle_probed_too_high_ &&
             prior_inflight >= model_->inflight_hi()) {
         is_risky = true;
+    } else if (model_->delay_trend() == DelayTrend::kOverusing) {
+        // The peer's receive times tell the queue is building up.
+        is_queuing = true;
     } else if (cycle_.rounds_in_phase > 0) {
         const size_t bdp = model_->bdp(model_->max_bw());
         size_t queuing_threshold_extra_bytes = 2 * Bbrparams::kDefaultTCPMSS;
@@ -248,7 +278,8 @@ void BbrProbeBandwidth::update_probe_up(size_t prior_inflight,
     }
 }
 
-void BbrProbeBandwidth::update_probe_cruise(
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::update_probe_cruise(
         const BbrCongestionEvent& congestion_event)
 {
     assert(cycle_.phase == CyclePhase::kPorbeCruise);
@@ -261,7 +292,8 @@ void BbrProbeBandwidth::update_probe_cruise(
     }
 }
 
-void BbrProbeBandwidth::update_probe_refill(
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::update_probe_refill(
         const BbrCongestionEvent& congestion_event)
 {
     assert(cycle_.phase == CyclePhase::kProbeRefill);
@@ -274,7 +306,8 @@ void BbrProbeBandwidth::update_probe_refill(
     }
 }
 
-void BbrProbeBandwidth::probe_inflight_high_upward(
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::probe_inflight_high_upward(
         const BbrCongestionEvent& congestion_event)
 {
     if (!model_->cwnd_limited(congestion_event)) {
@@ -302,8 +335,9 @@ void BbrProbeBandwidth::probe_inflight_high_upward(
     }
 }
 
-BbrProbeBandwidth::AdaptUpperBoundsResult
-BbrProbeBandwidth::maybe_adapt_upper_bounds(
+template <typename Profile>
+typename BbrProbeBandwidth<Profile>::AdaptUpperBoundsResult
+BbrProbeBandwidth<Profile>::maybe_adapt_upper_bounds(
         const BbrCongestionEvent& congestion_event)
 {
     const SendTimeState& send_state = congestion_event.last_packet_send_state;
@@ -312,8 +346,9 @@ BbrProbeBandwidth::maybe_adapt_upper_bounds(
     }
     bool has_enough_loss_events =
         model_->loss_events_in_round() >= bbr_->params().probe_bw_full_loss_count;
-    if(model_->is_inflight_too_high(congestion_event) &&
+    if((model_->is_inflight_too_high(congestion_event) &&
             has_enough_loss_events) //which is not used in tcp-bbr2
+            || model_->is_ecn_too_high())
     {
         if(cycle_.is_sample_from_probing)
         {
@@ -324,7 +359,7 @@ BbrProbeBandwidth::maybe_adapt_upper_bounds(
         return AdaptUpperBoundsResult::kOk;
     }
 
-    if(model_->inflight_hi() == BbrModel::kDefaultInflightBytes) {
+    if(model_->inflight_hi() == Model::kDefaultInflightBytes) {
         return AdaptUpperBoundsResult::kInfilghtHighNotSet;
     }
 
@@ -337,16 +372,18 @@ BbrProbeBandwidth::maybe_adapt_upper_bounds(
     return AdaptUpperBoundsResult::kOk;
 }
 
-void BbrProbeBandwidth::handle_inflight_too_high(bool app_limited,
+template <typename Profile>
+void BbrProbeBandwidth<Profile>::handle_inflight_too_high(bool app_limited,
         size_t bytes_inflight)
 {
     cycle_.is_sample_from_probing = false;
     if(!app_limited) {
         const size_t inflight_at_send = bytes_inflight(bytes_inflight);
         const size_t inflight_target = bbr_->target_inflight()
-                * (1 - bbr_->params().beta);
+                * (common::Gain::one() - bbr_->params().beta);
         if(bbr_->params().limit_inflight_hi_by_cwnd) {
-            const size_t cwnd_target = bbr_->cwnd() * (1 - bbr_->params().beta);
+            const size_t cwnd_target = bbr_->cwnd() *
+                    (common::Gain::one() - bbr_->params().beta);
             model_->set_inflight_hi(std::max(inflight_at_send, cwnd_target));
         } else {
             //tcp_bbr2.c
@@ -355,45 +392,54 @@ void BbrProbeBandwidth::handle_inflight_too_high(bool app_limited,
     }
 }
 
-bool BbrProbeBandwidth::is_time_to_probe_bw(
+template <typename Profile>
+bool BbrProbeBandwidth<Profile>::is_time_to_probe_bw(
         const BbrCongestionEvent& congestion_event)
 {
+    // Probe once the queueing delay is back under the target.
+    if (model_->latency_capped()) {
+        return false;
+    }
     if (congestion_event.event_time - cycle_.cycle_start_time >
             cycle_.probe_wait_time)
     {
         return true;
     }
 
-    if (is_time_to_probe_for_reno_coexistence(1.0, congestion_event)) {
+    if (is_time_to_probe_for_reno_coexistence(common::Gain::one(), congestion_event)) {
         return true;
     }
     return false;
 }
 
-bool BbrProbeBandwidth::is_time_to_probe_for_reno_coexistence(
-        double probe_wait_fraction,
+template <typename Profile>
+bool BbrProbeBandwidth<Profile>::is_time_to_probe_for_reno_coexistence(
+        common::Gain probe_wait_fraction,
         const BbrCongestionEvent& congestion_event)
 {
     uint64_t rounds = bbr_->params().probe_bw_probe_max_rounds;
-    if (bbr_->params().probe_bw_probe_reno_gain > 0.0) {
+    if (bbr_->params().probe_bw_probe_reno_gain > common::Gain(0.0)) {
         size_t target_bytes_inflight = bbr_->target_inflight();
         uint64_t reno_rounds = bbr_->params().probe_bw_probe_reno_gain *
                 target_bytes_inflight / Bbrparams::kDefaultTCPMSS;
         rounds = std::min(rounds, reno_rounds);
     }
-    bool result = cycle_.rounds_since_probe >= (rounds * probe_wait_fraction);
+    bool result = cycle_.rounds_since_probe >=
+            static_cast<size_t>(rounds) * probe_wait_fraction;
     //TODO: log something
     return result;
 }
 
-bool BbrProbeBandwidth::has_stayed_long_enough_in_probe_down(
+template <typename Profile>
+bool BbrProbeBandwidth<Profile>::has_stayed_long_enough_in_probe_down(
         const BbrCongestionEvent& congestion_event)
 {
     return congestion_event.event_time - cycle_.cycle_start_time >
         model_->min_rtt();
 }
 
-float BbrProbeBandwidth::pacing_gain(CyclePhase phase) const
+template <typename Profile>
+common::Gain BbrProbeBandwidth<Profile>::pacing_gain(CyclePhase phase) const
 {
     switch(phase)
     {
@@ -406,7 +452,8 @@ float BbrProbeBandwidth::pacing_gain(CyclePhase phase) const
     }
 }
 
-size_t BbrProbeBandwidth::cwnd_upper_limit() const
+template <typename Profile>
+size_t BbrProbeBandwidth<Profile>::cwnd_upper_limit() const
 {
     size_t upper_limit =
         std::min(model_->inflight_lo(), cycle_.phase == CyclePhase::kPorbeCruise
@@ -415,4 +462,6 @@ size_t BbrProbeBandwidth::cwnd_upper_limit() const
     //FIXME: do we need to avoid too low cwnd?
     return upper_limit;
 }
+
+BBR_INSTANTIATE_FOR_PROFILES(BbrProbeBandwidth);
 }
@@ -3,26 +3,28 @@
 
 #include <vector>
 #include <common/rate.h>
+#include <common/gain.h>
 #include <time/timestamp.h>
 #include <bbr_common.h>
 #include <bbr_mode.h>
 
 namespace bbr
 {
-class BbrAlgorithm;
-class BbrModel;
+template <typename Profile> class BasicBbrAlgorithm;
+template <typename Profile> class BasicBbrModel;
 struct BbrCongestionEvent;
 
+// Profile: see RuntimeProfile.
+template <typename Profile>
 class BbrProbeBandwidth
 {
-    enum class CyclePhase : uint8_t {
-        kProbeNotStarted = 0,
-        kPorbeUp,
-        kPorbeDown,
-        kPorbeCruise,
-        kProbeRefill,
-    };
+public:
+    using Algorithm = BasicBbrAlgorithm<Profile>;
+    using Model = BasicBbrModel<Profile>;
+
+    using CyclePhase = ProbeBwPhase;
 
+private:
     struct Cycle {
         time::Timestamp cycle_start_time{0};
         CyclePhase phase = CyclePhase::kProbeNotStarted;
@@ -47,7 +49,7 @@ class BbrProbeBandwidth
     };
 
 public:
-    BbrProbeBandwidth(BbrAlgorithm* bbr,  BbrModel* model);
+    BbrProbeBandwidth(Algorithm* bbr, Model* model);
 
     void enter(time::Timestamp now,
                const BbrCongestionEvent* congestion_event);
@@ -58,8 +60,8 @@ public:
     BbrMode on_congestion_event(
         size_t prior_inflight,
         time::Timestamp at_time,
-        const std::vector<AckedPacket>& acked_packets,
-        const std::vector<LostPacket>& lost_packets,
+        const std::vector<internal::AckedPacket>& acked_packets,
+        const std::vector<internal::LostPacket>& lost_packets,
         const BbrCongestionEvent& congestion_event);
 
     BbrMode on_exit_quiescence(time::Timestamp quiescence_start_time,
@@ -72,11 +74,15 @@ public:
 
     size_t cwnd_upper_limit() const ;
 
+    CyclePhase phase() const { return cycle_.phase;}
+
 private:
-    float pacing_gain(CyclePhase phase) const;
+    common::Gain pacing_gain(CyclePhase phase) const;
 
     void enter_probe_down(bool probed_too_high,
             bool stopped_risky_probe, time::Timestamp now);
+    // Reports the change to the model's BbrTransitionSink.
+    void set_phase(CyclePhase phase);
     void exist_probe_down();
     void enter_probe_up(time::Timestamp now);
     void enter_probe_cruise(time::Timestamp now);
@@ -95,7 +101,7 @@ private:
     bool is_time_to_probe_bw(
             const BbrCongestionEvent& congestion_event);
     bool is_time_to_probe_for_reno_coexistence(
-            double probe_wait_fraction,
+            common::Gain probe_wait_fraction,
             const BbrCongestionEvent& congestion_event);
 
     bool has_stayed_long_enough_in_probe_down(
@@ -111,8 +117,8 @@ private:
     void probe_inflight_high_upward(
             const BbrCongestionEvent& congestion_event);
 private:
-    BbrAlgorithm* bbr_;
-    BbrModel* model_;
+    Algorithm* bbr_;
+    Model* model_;
 
     Cycle cycle_;
 
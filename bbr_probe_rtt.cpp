@@ -4,27 +4,36 @@
 
 namespace bbr
 {
-BbrProbeRtt::BbrProbeRtt(BbrAlgorithm* bbr,  BbrModel* model)
+template <typename Profile>
+BbrProbeRtt<Profile>::BbrProbeRtt(Algorithm* bbr, Model* model)
     :bbr_(bbr),
      model_(model)
 {
     ;
 }
 
-void BbrProbeRtt::enter(time::Timestamp now,
+template <typename Profile>
+void BbrProbeRtt<Profile>::enter(time::Timestamp now,
         const BbrCongestionEvent* congestion_event)
 {
-    model_->set_pacing_gain(1.0);
-    model_->set_cwnd_gain(1.0);
+    model_->set_pacing_gain(common::Gain::one());
+    model_->set_cwnd_gain(common::Gain::one());
     exit_time_ = time::Timestamp::positive_infinity();
 }
 
+template <typename Profile>
+void BbrProbeRtt<Profile>::leave(time::Timestamp now,
+        const BbrCongestionEvent* /*congestion_event*/)
+{
+    model_->on_probe_rtt_done(now);
+}
 
-BbrMode BbrProbeRtt::on_congestion_event(
+template <typename Profile>
+BbrMode BbrProbeRtt<Profile>::on_congestion_event(
     size_t,
     time::Timestamp ,
-    const std::vector<AckedPacket>&,
-    const std::vector<LostPacket>&,
+    const std::vector<internal::AckedPacket>&,
+    const std::vector<internal::LostPacket>&,
     const BbrCongestionEvent& congestion_event)
 {
     if(!exit_time_.is_valid()) {
@@ -39,7 +48,8 @@ BbrMode BbrProbeRtt::on_congestion_event(
             BbrMode::PROBE_BW : BbrMode::PROBE_RTT;
 }
 
-BbrMode BbrProbeRtt::on_exit_quiescence(
+template <typename Profile>
+BbrMode BbrProbeRtt<Profile>::on_exit_quiescence(
         time::Timestamp /*quiescence_start_time*/,
         time::Timestamp now)
 {
@@ -49,17 +59,20 @@ BbrMode BbrProbeRtt::on_exit_quiescence(
     return BbrMode::PROBE_RTT;
 }
 
-size_t BbrProbeRtt::inflight_target() const
+template <typename Profile>
+size_t BbrProbeRtt<Profile>::inflight_target() const
 {
     return model_->bdp(model_->max_bw(),
             bbr_->params().probe_rtt_inflight_target_bdp_fraction);
 }
 
-size_t BbrProbeRtt::cwnd_upper_limit() const
+template <typename Profile>
+size_t BbrProbeRtt<Profile>::cwnd_upper_limit() const
 {
     size_t inflight_upper_bound =
         std::min(model_->inflight_lo(), model_->inflight_hi_with_headroom());
     return std::min(inflight_upper_bound, inflight_target());
 }
-}
 
+BBR_INSTANTIATE_FOR_PROFILES(BbrProbeRtt);
+}
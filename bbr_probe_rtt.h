@@ -11,14 +11,19 @@
 namespace bbr
 {
 
-class BbrAlgorithm;
-class BbrModel;
+template <typename Profile> class BasicBbrAlgorithm;
+template <typename Profile> class BasicBbrModel;
 class BbrCongestionEvent;
 
+// Profile: see RuntimeProfile.
+template <typename Profile>
 class BbrProbeRtt
 {
 public:
-    BbrProbeRtt(BbrAlgorithm* bbr,  BbrModel* model);
+    using Algorithm = BasicBbrAlgorithm<Profile>;
+    using Model = BasicBbrModel<Profile>;
+
+    BbrProbeRtt(Algorithm* bbr, Model* model);
 
     bool is_probing() const { return false;}
 
@@ -26,13 +31,13 @@ public:
                const BbrCongestionEvent* congestion_event);
 
     void leave(time::Timestamp now,
-               const BbrCongestionEvent* congestion_event) {};
+               const BbrCongestionEvent* congestion_event);
 
     BbrMode on_congestion_event(
         size_t prior_inflight,
         time::Timestamp at_time,
-        const std::vector<AckedPacket>& acked_packets,
-        const std::vector<LostPacket>& lost_packets,
+        const std::vector<internal::AckedPacket>& acked_packets,
+        const std::vector<internal::LostPacket>& lost_packets,
         const BbrCongestionEvent& congestion_event);
 
     BbrMode on_exit_quiescence(time::Timestamp quiescence_start_time,
@@ -43,8 +48,8 @@ public:
     size_t cwnd_upper_limit() const;
 
 private:
-    BbrAlgorithm* bbr_;
-    BbrModel* model_;
+    Algorithm* bbr_;
+    Model* model_;
 
     time::Timestamp exit_time_;
 };
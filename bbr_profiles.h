@@ -0,0 +1,94 @@
+#ifndef BBR_PROFILES_H_
+#define BBR_PROFILES_H_
+
+#include <bbr_params.h>
+
+namespace bbr
+{
+// Fixed parameter profiles, constexpr so that the values can be used in
+// constant expressions. BbrAlgorithm keeps its own copy of the profile it
+// is created with, BasicBbrAlgorithm<Profile> none, see RuntimeProfile.
+namespace profiles
+{
+// quic_bbr2 defaults, for bulk transfers.
+inline constexpr Bbrparams kDefault {};
+
+constexpr Bbrparams make_low_latency()
+{
+    Bbrparams params;
+    // Interactive media: keep the standing queue small rather than filling
+    // the pipe as fast as possible.
+    params.startup_cwnd_gain = common::Gain(2.0);
+    params.drain_cwnd_gain = common::Gain(2.0);
+    params.probe_bw_cwnd_gain = common::Gain(1.5);
+    params.inflight_hi_headroom_fraction = common::Gain(0.15); //tcp_bbr2.c
+    params.probe_rtt_duration = time::TimeDelta(100 * 1000);
+    params.min_rtt_win = time::TimeDelta(5 * 1000 * 1000);
+    // Avoid the periodic PROBE_RTT throughput dips of media flows.
+    params.min_rtt_sliding_window = true;
+    return params;
+}
+
+// Low latency (RTC) flows.
+inline constexpr Bbrparams kLowLatency = make_low_latency();
+
+constexpr Bbrparams make_real_time()
+{
+    Bbrparams params = make_low_latency();
+    // Interactive video: the queueing delay stays under 50ms, even while
+    // probing for bandwidth.
+    params.max_queueing_delay = time::TimeDelta(50 * 1000);
+    return params;
+}
+
+inline constexpr Bbrparams kRealTime = make_real_time();
+}
+
+// The Profile of BasicBbrAlgorithm, BasicBbrModel and the modes. The
+// default, RuntimeProfile, takes the parameters at construction and keeps
+// a copy of them. Any other Profile fixes them at compile time as its
+// 'static constexpr Bbrparams kParams', which the compiler folds into the
+// per-ack path as immediates; the Bbrparams passed at construction are
+// then ignored.
+struct RuntimeProfile {};
+
+namespace profiles
+{
+struct Default { static constexpr Bbrparams kParams = kDefault;};
+struct LowLatency { static constexpr Bbrparams kParams = kLowLatency;};
+struct RealTime { static constexpr Bbrparams kParams = kRealTime;};
+}
+
+namespace internal
+{
+// Where the parameters of a Profile are read from.
+template <typename Profile>
+class ProfileParams
+{
+public:
+    explicit constexpr ProfileParams(const Bbrparams&) {}
+
+    static constexpr const Bbrparams& get() { return Profile::kParams;}
+};
+
+template <>
+class ProfileParams<RuntimeProfile>
+{
+public:
+    explicit ProfileParams(const Bbrparams& params) : params_(params) {}
+
+    const Bbrparams& get() const { return params_;}
+private:
+    Bbrparams params_;
+};
+}
+
+// The class templates of the algorithm keep their code in .cpp files,
+// which instantiate them for every profile above.
+#define BBR_INSTANTIATE_FOR_PROFILES(Class) \
+    template class Class<RuntimeProfile>; \
+    template class Class<profiles::Default>; \
+    template class Class<profiles::LowLatency>; \
+    template class Class<profiles::RealTime>
+}
+#endif
@@ -3,11 +3,18 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <packet_history.h>
+#include <cassert>
+#include <chrono>
+#include <memory>
 #include <packet_buffer.h>
+#include <coupled_send_queue.h>
+#include <sent_packet_table.h>
 #include <loss_detect.h>
 #include <bbr_algorithm.h>
-#include <common/circular_buffer.h>
+#include <bbr_observer.h>
+#include <bbr_stats.h>
+#include <common/seqlock.h>
+#include <time/clock.h>
 
 namespace bbr
 {
@@ -17,10 +24,82 @@ public:
     bool send_pkt(SendingPacket&& pkt) = 0;
 };
 
-class BbrSender
+namespace internal
+{
+//measures the cpu time of one ack callback
+class ScopedAckTimer
 {
 public:
-    BbrSender(PacketSender* sender);
+    explicit ScopedAckTimer(BbrHistograms* histograms)
+        :histograms_(histograms)
+    {
+        if(histograms_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~ScopedAckTimer()
+    {
+        if(histograms_) {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            histograms_->ack_processing_ns.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+private:
+    BbrHistograms* histograms_;
+    std::chrono::steady_clock::time_point start_;
+};
+}
+
+// Policies, all resolved at compile time:
+// Clock: 'time::Timestamp now()', see time/clock.h.
+// SendQueue: the packets buffered while cwnd is full, PacketBuffer's interface.
+// LossDetector: LossDetect's interface, reads the shared SentPacketTable.
+// Observer: BbrAlgorithm's trace hooks, see bbr_observer.h.
+// Profile: where BbrAlgorithm's parameters come from, see RuntimeProfile.
+template <typename Clock = time::SystemClock,
+         typename SendQueue = PacketBuffer,
+         typename LossDetector = LossDetect,
+         typename Observer = NullBbrObserver,
+         typename Profile = RuntimeProfile>
+class BasicBbrSender
+{
+public:
+    // |params|: see bbr_profiles.h, ignored unless Profile is RuntimeProfile.
+    BasicBbrSender(PacketSender* sender,
+            const Bbrparams& params = profiles::kDefault,
+            Clock clock = Clock(),
+            Observer observer = Observer());
+    ~BasicBbrSender();
+
+    // Starts a new connection on |sender| as if just constructed, keeping
+    // the allocated memory, see BasicBbrSenderPool. The profile, the clock
+    // and the observer are kept, the histograms are detached.
+    void reset(PacketSender* sender);
+
+    // Nothing in flight and nothing buffered.
+    bool is_quiescent() const {
+        return bytes_inflight_ == 0 && pkts_buffer_.size() == 0;
+    }
+
+    // Frees the BbrAlgorithm and the buffers kept for packets in flight
+    // while quiescent, e.g. from the idle timer of a long-poll connection.
+    // Only the estimates (max_bw, min_rtt, inflight_hi) are kept. The next
+    // send builds a new BbrAlgorithm restored from them as they were, see
+    // BbrAlgorithm::restore(): in PROBE_BW, as after any idle period, or
+    // in STARTUP if the previous one had not ended.
+    // Returns false, doing nothing, if not quiescent.
+    bool hibernate();
+
+    bool is_hibernating() const { return !bbr_;}
+
+    // Hibernates automatically whenever an ack leaves the sender quiescent.
+    // Off by default: request/response connections would rebuild the
+    // algorithm for every request.
+    void set_hibernate_when_quiescent(bool enabled) {
+        hibernate_when_quiescent_ = enabled;
+    }
+
     // return false if bbr determines to buffered this pkt
     // packet size must be less than 1460
     bool send_or_queued_pkt(SendingPacket&& pkt);
@@ -35,29 +114,450 @@ public:
     //recommanded bandwidth
     common::BandWidth bandwidth() const;
 
+    //latest snapshot, refreshed once per ack event.
+    //safe to call from any thread, never blocks the sending thread.
+    BbrStats stats() const { return stats_.load();}
+
+    //optional distributions of rtt/bandwidth samples, extra_acked and
+    //ack processing time. not owned, nullptr(default) disables them.
+    void set_histograms(BbrHistograms* histograms);
+
+    //warm starts from the estimates |cache| holds for |key| (the
+    //destination), see BbrAlgorithm::warm_start(), and keeps the estimates
+    //there when the connection hibernates or ends. must be called before the
+    //first packet is sent. not owned, nullptr(default) disables it.
+    void set_path_cache(PathCache* cache, uint64_t key);
+
+    //enters PROBE_RTT together with the other connections sharing
+    //|coordinator|, typically all connections to the same destination.
+    //not owned, nullptr(default) probes alone.
+    void set_probe_rtt_coordinator(ProbeRttCoordinator* coordinator) {
+        probe_rtt_coordinator_ = coordinator;
+        if(bbr_) {
+            bbr_->set_probe_rtt_coordinator(coordinator);
+        }
+    }
+
+    Clock& clock() { return clock_;}
+    Observer& observer() { return observer_;}
+    LossDetector& loss_detect() { return loss_detect_;}
+    //e.g. to add the streams of a CoupledBbrSender
+    SendQueue& send_queue() { return pkts_buffer_;}
+
 private:
     bool send_pkt(SendingPacket&& pkt);
 
 private:
     void check_after_acked();
+    void publish_stats(time::Timestamp now);
     size_t bytes_inflight() const {
         return bytes_inflight_;
     }
 
-    BbrAlgorithm bbr_;
-    LossDetect loss_detect_;
+    void erase_sent_pkts(const std::vector<internal::AckedPacket>& acked_pkts,
+            const std::vector<internal::LostPacket>& lost_pkts);
+
+    // Declares lost the packets SentPacketTable::kMaxSpan behind |seq_no|.
+    void give_up_stale_pkts(uint64_t seq_no, time::Timestamp now);
+
+    void save_path_info();
+
+    // Rebuilds the algorithm of a hibernating sender.
+    void wake_up(time::Timestamp now);
 
-    PacketHistory<SendingPacket,
-    common::CircularBuffer> pkts_history_; //buffered all sent but not acked packets
+    Clock clock_;
+    Observer observer_;
 
-    using SentPktType = PacketHistory<SendingPacket,
-            common::CircularBuffer>::SentPkt;
+    //all sent but not acked packets, shared with loss_detect_ and bbr_
+    SentPacketTable sent_pkts_{true};
 
-    PacketBuffer pkts_buffer_; //buffered sending packets
+    Bbrparams params_;
+    //nullptr while hibernating
+    std::unique_ptr<BasicBbrAlgorithm<Profile>> bbr_;
+    //the estimates kept while hibernating
+    BbrHibernationState hibernated_;
+    bool hibernate_when_quiescent_ = false;
+    LossDetector loss_detect_;
+
+    SendQueue pkts_buffer_; //buffered sending packets
 
     PacketSender* socket_;
 
     size_t bytes_inflight_ = 0; //total sent but didn't acked
+
+    uint64_t total_pkts_lost_ = 0;
+    common::SeqLock<BbrStats> stats_;
+
+    BbrHistograms* histograms_ = nullptr;
+
+    PathCache* path_cache_ = nullptr;
+    uint64_t path_key_ = 0;
+    ProbeRttCoordinator* probe_rtt_coordinator_ = nullptr;
 };
+
+using BbrSender = BasicBbrSender<>;
+// Several streams to one peer sharing a single congestion controller, see
+// CoupledSendQueue.
+using CoupledBbrSender = BasicBbrSender<time::SystemClock, CoupledSendQueue>;
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::BasicBbrSender(
+        PacketSender* sender, const Bbrparams& params,
+        Clock clock, Observer observer)
+    :clock_(std::move(clock)),
+     observer_(std::move(observer)),
+     params_(internal::ProfileParams<Profile>(params).get()),
+     bbr_(new BasicBbrAlgorithm<Profile>(params_, default_params::kInitCwnd,
+             default_params::kInitRtt, clock_.now())),
+     socket_(sender)
+{
+    assert(socket_ != nullptr);
+    bbr_->set_sent_packets(&sent_pkts_);
+    loss_detect_.set_sent_packets(&sent_pkts_);
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::~BasicBbrSender()
+{
+    save_path_info();
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::reset(
+        PacketSender* sender)
+{
+    save_path_info();
+    path_cache_ = nullptr;
+    path_key_ = 0;
+    set_probe_rtt_coordinator(nullptr);
+
+    socket_ = sender;
+    assert(socket_ != nullptr);
+    sent_pkts_.clear();
+    pkts_buffer_.clear();
+    loss_detect_.reset();
+    if(bbr_) {
+        bbr_->reset(clock_.now());
+    } else {
+        hibernated_ = BbrHibernationState();
+        wake_up(clock_.now());
+    }
+    set_histograms(nullptr);
+
+    bytes_inflight_ = 0;
+    total_pkts_lost_ = 0;
+    stats_.store(BbrStats());
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+bool BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::hibernate()
+{
+    if(!bbr_) {
+        return true;
+    }
+    if(!is_quiescent() || !sent_pkts_.empty()) {
+        return false;
+    }
+    save_path_info();
+    hibernated_ = bbr_->hibernation_state();
+    bbr_.reset();
+    sent_pkts_.release();
+    pkts_buffer_.release_memory();
+    return true;
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::wake_up(
+        time::Timestamp now)
+{
+    if(bbr_) {
+        return;
+    }
+    bbr_.reset(new BasicBbrAlgorithm<Profile>(params_, default_params::kInitCwnd,
+            default_params::kInitRtt, now));
+    bbr_->set_sent_packets(&sent_pkts_);
+    bbr_->set_histograms(histograms_);
+    bbr_->set_probe_rtt_coordinator(probe_rtt_coordinator_);
+    if(hibernated_.is_valid()) {
+        bbr_->restore(hibernated_, now);
+    }
+    hibernated_ = BbrHibernationState();
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+bool BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::send_or_queued_pkt(
+        SendingPacket&& pkt)
+{
+    wake_up(clock_.now());
+    size_t bytes_inflight = bytes_inflight();
+    if(!bbr_->can_send(bytes_inflight)) {
+        pkts_buffer_.insert(typename SendQueue::Packet{false, std::move(pkt)});
+        return false;
+    }
+    return send_pkt(std::move(pkt));
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+bool BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::send_pkt(
+        SendingPacket&& pkt)
+{
+    auto now = clock_.now();
+    const uint64_t seq_no = pkt.seq_no;
+    const size_t size = pkt.size;
+    give_up_stale_pkts(seq_no, now);
+    //the payload is kept for retransmission, the socket takes the packet
+    size_t slot = sent_pkts_.insert(seq_no, size, now);
+    sent_pkts_.payload(slot) = pkt;
+    bool ret = socket_->send_pkt(std::move(pkt));
+    bbr_->on_packet_sent(seq_no, size, bytes_inflight(),
+            true, now, observer_);
+
+    bytes_inflight_ += size;
+
+    return ret;
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::on_pkt_ack(
+        const AckedPacket& pkt)
+{
+    if(!bbr_) {
+        //nothing is in flight while hibernating
+        return;
+    }
+    internal::ScopedAckTimer timer(histograms_);
+    auto now = clock_.now();
+    size_t prior_bytes_infligth = bytes_inflight();
+    auto lost_nos = loss_detect_.on_pkt_ack(pkt);
+
+    size_t lost_bytes = 0;
+    std::vector<internal::LostPacket> lost_pkts;
+    for(auto lost_no : lost_nos) {
+        size_t lost = sent_pkts_.find(lost_no);
+        assert(lost != SentPacketTable::npos);
+        lost_pkts.push_back({lost_no, sent_pkts_.bytes(lost)});
+        lost_bytes += sent_pkts_.bytes(lost);
+    }
+    assert(bytes_inflight_ >= lost_bytes);
+    bytes_inflight_ -= lost_bytes;
+    total_pkts_lost_ += lost_pkts.size();
+
+    size_t sending_pkt = sent_pkts_.find(pkt.seq_no);
+    if(sending_pkt == SentPacketTable::npos) {
+        //log error
+        return ;
+    }
+    size_t acked_bytes = sent_pkts_.bytes(sending_pkt);
+    assert(bytes_inflight_ >= acked_bytes);
+    bytes_inflight_ -= acked_bytes;
+
+    std::vector<internal::AckedPacket> acked_pkts{
+        {pkt.seq_no, acked_bytes, pkt.arrival_time}};
+    bbr_->on_congestion_event(prior_bytes_infligth, now, acked_pkts, lost_pkts,
+            observer_, pkt.ecn_ce ? 1 : 0);
+    erase_sent_pkts(acked_pkts, lost_pkts);
+
+    check_after_acked();
+    publish_stats(now);
+    if(hibernate_when_quiescent_) {
+        hibernate();
+    }
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::on_pkts_ack(
+        const std::vector<AckedTrunk>& trunks)
+{
+    if(!bbr_) {
+        //nothing is in flight while hibernating
+        return;
+    }
+    internal::ScopedAckTimer timer(histograms_);
+    auto now = clock_.now();
+    size_t prior_bytes_infligth = bytes_inflight();
+    auto lost_nos = loss_detect_.on_pkts_ack(trunks);
+
+    size_t lost_bytes = 0;
+    std::vector<internal::LostPacket> lost_pkts;
+    for(auto lost_no : lost_nos) {
+        size_t lost = sent_pkts_.find(lost_no);
+        assert(lost != SentPacketTable::npos);
+        lost_pkts.push_back({lost_no, sent_pkts_.bytes(lost)});
+        lost_bytes += sent_pkts_.bytes(lost);
+    }
+    assert(bytes_inflight_ >= lost_bytes);
+    bytes_inflight_ -= lost_bytes;
+    total_pkts_lost_ += lost_pkts.size();
+
+    size_t acked_bytes = 0;
+    size_t ecn_ce_count = 0;
+    std::vector<internal::AckedPacket> acked_pkts;
+    for(const auto& trunk : trunks) {
+        assert(trunk.seq_no_end >= trunk.seq_no_begin);
+        ecn_ce_count += trunk.ecn_ce_count;
+        assert(trunk.arrival_times.size() ==
+                trunk.seq_no_end-trunk.seq_no_begin+1);
+        for(uint64_t seq_no = trunk.seq_no_begin;
+                seq_no <= trunk.seq_no_end; seq_no ++)
+        {
+            size_t acked = sent_pkts_.find(seq_no);
+            //if we received fake ack-frame, ignore it
+            if(acked == SentPacketTable::npos) {
+                continue;
+            }
+            acked_pkts.push_back({seq_no, sent_pkts_.bytes(acked),
+                trunk.arrival_times[seq_no-trunk.seq_no_begin]});
+            acked_bytes += sent_pkts_.bytes(acked);
+        }
+    }
+    assert(bytes_inflight_ >= acked_bytes);
+    bytes_inflight_ -= acked_bytes;
+
+    bbr_->on_congestion_event(prior_bytes_infligth, now, acked_pkts, lost_pkts,
+            observer_, ecn_ce_count);
+    erase_sent_pkts(acked_pkts, lost_pkts);
+
+    check_after_acked();
+    publish_stats(now);
+    if(hibernate_when_quiescent_) {
+        hibernate();
+    }
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::set_histograms(
+        BbrHistograms* histograms)
+{
+    histograms_ = histograms;
+    if(bbr_) {
+        bbr_->set_histograms(histograms);
+    }
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::set_path_cache(
+        PathCache* cache, uint64_t key)
+{
+    path_cache_ = cache;
+    path_key_ = key;
+    if(!path_cache_) {
+        return;
+    }
+    auto now = clock_.now();
+    wake_up(now);
+    PathInfo path;
+    if(path_cache_->lookup(path_key_, PathCache::now(), params_.resume_max_age,
+            path)) {
+        bbr_->warm_start(path, now);
+    }
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::save_path_info()
+{
+    //saved by hibernate() already
+    if(!path_cache_ || !bbr_) {
+        return;
+    }
+    PathInfo path = bbr_->path_info();
+    path.key = path_key_;
+    path.updated_at = PathCache::now();
+    if(path.is_valid()) {
+        path_cache_->update(path);
+    }
+}
+
+//acked and lost packets are no longer in flight, the sampler has consumed
+//their states during 'on_congestion_event'
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::erase_sent_pkts(
+        const std::vector<internal::AckedPacket>& acked_pkts,
+        const std::vector<internal::LostPacket>& lost_pkts)
+{
+    for(const auto& pkt : acked_pkts) {
+        sent_pkts_.erase(pkt.seq_no);
+    }
+    for(const auto& pkt : lost_pkts) {
+        sent_pkts_.erase(pkt.seq_no);
+    }
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::give_up_stale_pkts(
+        uint64_t seq_no, time::Timestamp now)
+{
+    if(sent_pkts_.empty() || seq_no < sent_pkts_.first() + SentPacketTable::kMaxSpan) {
+        return;
+    }
+    size_t prior_bytes_infligth = bytes_inflight();
+    const uint64_t up_to = seq_no - SentPacketTable::kMaxSpan + 1;
+    std::vector<internal::LostPacket> lost_pkts;
+    for(uint64_t lost_no = sent_pkts_.first(); lost_no < up_to; lost_no++) {
+        size_t lost = sent_pkts_.find(lost_no);
+        if(lost == SentPacketTable::npos) {
+            continue;
+        }
+        lost_pkts.push_back({lost_no, sent_pkts_.bytes(lost)});
+        assert(bytes_inflight_ >= sent_pkts_.bytes(lost));
+        bytes_inflight_ -= sent_pkts_.bytes(lost);
+    }
+    total_pkts_lost_ += lost_pkts.size();
+    bbr_->on_congestion_event(prior_bytes_infligth, now, {}, lost_pkts,
+            observer_);
+    erase_sent_pkts({}, lost_pkts);
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::check_after_acked()
+{
+    // 1) check if we can send buffered pkts now
+    while(pkts_buffer_.size() && bbr_->can_send(bytes_inflight())) {
+        auto pkt = pkts_buffer_.pop();
+        send_pkt(std::move(pkt.pkt));
+    }
+    // 2) any else ?
+}
+
+template <typename Clock, typename SendQueue, typename LossDetector,
+         typename Observer, typename Profile>
+void BasicBbrSender<Clock, SendQueue, LossDetector, Observer, Profile>::publish_stats(
+        time::Timestamp now)
+{
+    const auto& model = bbr_->model();
+    BbrStats stats;
+    stats.mode = bbr_->mode();
+    stats.cwnd = bbr_->cwnd();
+    stats.pacing_rate = bbr_->pacing_rate();
+    stats.max_bw = model.max_bw();
+    stats.estimated_bw = model.estimated_bw();
+    stats.min_rtt = model.min_rtt();
+    stats.bytes_in_flight = bytes_inflight();
+    stats.inflight_hi = model.inflight_hi();
+    stats.max_ack_height = model.max_ack_hegith();
+    stats.total_bytes_sent = model.total_bytes_sent();
+    stats.total_bytes_acked = model.total_bytes_acked();
+    stats.total_bytes_lost = model.total_bytes_lost();
+    stats.total_pkts_lost = total_pkts_lost_;
+    stats.at_time = now;
+    stats_.store(stats);
+}
+
+// The default sender is compiled once, in bbr_sender.cpp.
+extern template class BasicBbrSender<>;
 }
 #endif
@@ -0,0 +1,52 @@
+#ifndef BBR_SENDER_POOL_H_
+#define BBR_SENDER_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <bbr_sender.h>
+
+namespace bbr
+{
+// Recycles the senders of short lived connections: a released sender is
+// kept and reset() when acquired again, instead of being destroyed and
+// constructed with all its components and buffers.
+// Not thread safe, one pool per thread driving the connections.
+template <typename Sender = BbrSender>
+class BasicBbrSenderPool
+{
+public:
+    // At most |max_idle| released senders are kept, the others are freed.
+    explicit BasicBbrSenderPool(const Bbrparams& params = profiles::kDefault,
+            size_t max_idle = 64)
+        :params_(params),
+         max_idle_(max_idle)
+    {}
+
+    std::unique_ptr<Sender> acquire(PacketSender* sender) {
+        if (idle_.empty()) {
+            return std::unique_ptr<Sender>(new Sender(sender, params_));
+        }
+        std::unique_ptr<Sender> recycled = std::move(idle_.back());
+        idle_.pop_back();
+        recycled->reset(sender);
+        return recycled;
+    }
+
+    void release(std::unique_ptr<Sender> sender) {
+        if (sender && idle_.size() < max_idle_) {
+            idle_.push_back(std::move(sender));
+        }
+    }
+
+    size_t idle() const { return idle_.size();}
+
+private:
+    const Bbrparams params_;
+    const size_t max_idle_;
+    std::vector<std::unique_ptr<Sender>> idle_;
+};
+
+using BbrSenderPool = BasicBbrSenderPool<>;
+}
+#endif
@@ -5,21 +5,30 @@
 
 namespace bbr
 {
-BbrStartupMode::BbrStartupMode(BbrAlgorithm* bbr, BbrModel* model)
+template <typename Profile>
+BbrStartupMode<Profile>::BbrStartupMode(Algorithm* bbr, Model* model)
     :bbr_(bbr),
     model_(model)
 {
 
 }
-BbrMode BbrStartupMode::on_congestion_event(
+template <typename Profile>
+BbrMode BbrStartupMode<Profile>::on_congestion_event(
     size_t,
     time::Timestamp,
-    const std::vector<AckedPacket>&,
-    const std::vector<LostPacket>&,
+    const std::vector<internal::AckedPacket>&,
+    const std::vector<internal::LostPacket>&,
     const BbrCongestionEvent& congestion_event)
 {
     check_full_bw_reached(congestion_event);
 
+    check_rtt_increase(congestion_event);
+
+    // Earlier than the rtt increase, see Bbrparams::delay_gradient_enabled.
+    if (model_->delay_trend() == DelayTrend::kOverusing) {
+        full_bw_reached_ = true;
+    }
+
     Check_excessive_losses(congestion_event);
 
     model_->set_cwnd_gain(bbr_->params().startup_cwnd_gain);
@@ -29,7 +38,8 @@ BbrMode BbrStartupMode::on_congestion_event(
     return full_bw_reached_ ? BbrMode::DRAIN : BbrMode::STARTUP;
 }
 
-void BbrStartupMode::check_full_bw_reached(
+template <typename Profile>
+void BbrStartupMode<Profile>::check_full_bw_reached(
         const BbrCongestionEvent& congestion_event)
 {
     if (full_bw_reached_ || !congestion_event.end_of_round_trip ||
@@ -50,7 +60,8 @@ void BbrStartupMode::check_full_bw_reached(
     //TODO: log something
 }
 
-void BbrStartupMode::Check_excessive_losses(
+template <typename Profile>
+void BbrStartupMode<Profile>::Check_excessive_losses(
         const BbrCongestionEvent& congestion_event)
 {
     if (full_bw_reached_) {
@@ -61,12 +72,15 @@ void BbrStartupMode::Check_excessive_losses(
     // In TCP, loss based exit only happens at end of a loss round.
     // we use the end of the normal round here. It is possible to exit after
     // any congestion event, using information of the "rolling round".
-    if (!congestion_event.end_of_round_trip) {
+    if (!congestion_event.end_of_round_trip &&
+            !bbr_->params().startup_rolling_round_check) {
         return;
     }
-    // At the end of a round trip. Check if loss is too high in this round.
-    if (loss_events_in_round >= bbr_->params().startup_full_loss_count &&
-            model_->is_inflight_too_high(congestion_event))
+    // At the end of a round trip. Check if loss is too high in this round,
+    // or if ECN marks tell that the queue is building up.
+    if ((loss_events_in_round >= bbr_->params().startup_full_loss_count &&
+            model_->is_inflight_too_high(congestion_event)) ||
+            model_->is_ecn_too_high())
     {
         auto bdp = model_->bdp(model_->max_bw());
         model_->set_inflight_hi(bdp);
@@ -75,9 +89,57 @@ void BbrStartupMode::Check_excessive_losses(
     }
 }
 
-size_t BbrStartupMode::cwnd_upper_limit() const
+// HyStart++ (RFC 9406) round tracking. The rtt samples of the event that
+// ends a round already count for the next one.
+template <typename Profile>
+void BbrStartupMode<Profile>::check_rtt_increase(
+        const BbrCongestionEvent& congestion_event)
+{
+    const Bbrparams& params = bbr_->params();
+    if (full_bw_reached_ || !params.startup_exit_on_rtt_increase) {
+        return;
+    }
+
+    if (congestion_event.end_of_round_trip) {
+        if (!params.startup_rolling_round_check && rtt_increased()) {
+            full_bw_reached_ = true;
+            return;
+        }
+        last_round_min_rtt_ = cur_round_min_rtt_;
+        cur_round_min_rtt_ = time::TimeDelta::positive_infinity();
+        rtt_samples_in_round_ = 0;
+    }
+
+    if (congestion_event.sample_min_rtt.is_valid()) {
+        cur_round_min_rtt_ = std::min(cur_round_min_rtt_,
+                congestion_event.sample_min_rtt);
+        rtt_samples_in_round_ += congestion_event.rtt_sample_count;
+    }
+
+    if (params.startup_rolling_round_check && rtt_increased()) {
+        full_bw_reached_ = true;
+    }
+}
+
+template <typename Profile>
+bool BbrStartupMode<Profile>::rtt_increased() const
+{
+    const Bbrparams& params = bbr_->params();
+    if (rtt_samples_in_round_ < params.startup_rtt_sample_count ||
+            !cur_round_min_rtt_.is_valid() || !last_round_min_rtt_.is_valid()) {
+        return false;
+    }
+    time::TimeDelta threshold = std::min(std::max(
+            last_round_min_rtt_ * params.startup_rtt_thresh_fraction,
+            params.startup_min_rtt_thresh), params.startup_max_rtt_thresh);
+    return cur_round_min_rtt_ >= last_round_min_rtt_ + threshold;
+}
+
+template <typename Profile>
+size_t BbrStartupMode<Profile>::cwnd_upper_limit() const
 {
     return model_->inflight_lo();
 }
 
+BBR_INSTANTIATE_FOR_PROFILES(BbrStartupMode);
 }
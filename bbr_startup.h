@@ -9,25 +9,37 @@
 
 namespace bbr
 {
-class BbrAlgorithm;
-class BbrModel;
+template <typename Profile> class BasicBbrAlgorithm;
+template <typename Profile> class BasicBbrModel;
 struct BbrCongestionEvent;
 
 //we won't enter start-up mode more than once
+// Profile: see RuntimeProfile.
+template <typename Profile>
 class BbrStartupMode
 {
 public:
-    BbrStartupMode(BbrAlgorithm* bbr, BbrModel* model);
+    using Algorithm = BasicBbrAlgorithm<Profile>;
+    using Model = BasicBbrModel<Profile>;
+
+    BbrStartupMode(Algorithm* bbr, Model* model);
 
     bool is_probing() const { return true;}
 
     bool full_bw_reached() const { return full_bw_reached_;}
 
+    // The bandwidth is known from a previous connection, see
+    // BbrAlgorithm::warm_start().
+    void skip(common::BandWidth bw) {
+        full_bw_reached_ = true;
+        full_bw_baseline_ = bw;
+    }
+
     BbrMode on_congestion_event(
         size_t prior_inflight,
         time::Timestamp at_time,
-        const std::vector<AckedPacket>& acked_packets,
-        const std::vector<LostPacket>& lost_packets,
+        const std::vector<internal::AckedPacket>& acked_packets,
+        const std::vector<internal::LostPacket>& lost_packets,
         const BbrCongestionEvent& congestion_event);
 
     void enter(time::Timestamp now,
@@ -44,14 +56,21 @@ public:
 private:
     void check_full_bw_reached(const BbrCongestionEvent& congestion_event);
     void Check_excessive_losses(const BbrCongestionEvent& congestion_event);
+    void check_rtt_increase(const BbrCongestionEvent& congestion_event);
+    bool rtt_increased() const;
 
 private:
-    BbrAlgorithm* bbr_;
-    BbrModel* model_;
+    Algorithm* bbr_;
+    Model* model_;
 
     bool full_bw_reached_ = false;
     common::BandWidth full_bw_baseline_;
     uint64_t rounds_without_bw_growth_ = 0;
+
+    // Min rtt of the current and the previous round, for the delay based exit.
+    time::TimeDelta cur_round_min_rtt_;
+    time::TimeDelta last_round_min_rtt_;
+    size_t rtt_samples_in_round_ = 0;
 };
 }
 #endif
@@ -0,0 +1,41 @@
+#ifndef BBR_STATS_H_
+#define BBR_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <common/rate.h>
+#include <time/timestamp.h>
+#include <bbr_mode.h>
+
+namespace bbr
+{
+// Snapshot of a connection's congestion control state.
+// Published by BbrSender once per ack event, see BbrSender::stats().
+struct BbrStats
+{
+    BbrMode mode = BbrMode::STARTUP;
+
+    size_t cwnd = 0;
+    common::BandWidth pacing_rate {0};
+
+    // Max bandwidth filter and the bandwidth actually used by the model
+    // (bounded by bw_lo).
+    common::BandWidth max_bw {0};
+    common::BandWidth estimated_bw {0};
+
+    time::TimeDelta min_rtt;
+
+    size_t bytes_in_flight = 0;
+    size_t inflight_hi = 0;
+    size_t max_ack_height = 0;
+
+    uint64_t total_bytes_sent = 0;
+    uint64_t total_bytes_acked = 0;
+    uint64_t total_bytes_lost = 0;
+    uint64_t total_pkts_lost = 0;
+
+    // When this snapshot was taken.
+    time::Timestamp at_time;
+};
+}
+#endif
@@ -12,9 +12,10 @@ using std::string;
 using std::unique_ptr;
 using std::shared_ptr;
 
-AsyncLogging::AsyncLogging(const string& file_path,uint64_t rollsize)
+AsyncLogging::AsyncLogging(const string& file_path,uint64_t rollsize,int compress_level)
     :log_file_path_ (file_path),
     roll_size_( rollsize),
+    compress_level_(compress_level),
     cur_buffer_(new Buffer),
     next_buffer_(new Buffer),
     running_(true)
@@ -62,7 +63,7 @@ int AsyncLogging::thread_pro(void)
     temp_buffer2->clear();
     buffers_to_write.reserve(16); 
     auto sec = std::chrono::seconds(1);
-    LogFile log_file(log_file_path_,roll_size_);
+    LogFile log_file(log_file_path_,roll_size_,compress_level_);
     while(running_)
     {
         assert(temp_buffer1 != nullptr);
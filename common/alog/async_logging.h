@@ -17,7 +17,8 @@ class AsyncLogging{
     using Bufferptr = std::unique_ptr<Buffer>;
     using Buffers   = std::vector<std::unique_ptr<Buffer>>;
 public:
-    AsyncLogging(const std::string& file_path,uint64_t roll_size=0);
+    //compress_level > 0时日志段使用zstd压缩, 见LogFile
+    AsyncLogging(const std::string& file_path,uint64_t roll_size=0,int compress_level=0);
     ~AsyncLogging();
     void append(const char* content,size_t size);
 private:
@@ -25,6 +26,7 @@ private:
 
     std::string             log_file_path_;
     uint64_t                roll_size_; 
+    int                     compress_level_;
     uint32_t                reserve_days_;
     Bufferptr               cur_buffer_;
     Bufferptr               next_buffer_;
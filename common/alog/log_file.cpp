@@ -3,6 +3,16 @@
 #include <stdlib.h>
 #include <cassert>
 #include <algorithm>
+#ifdef RTC_ALOG_USE_IO_URING
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <liburing.h>
+#endif
+#ifdef RTC_ALOG_USE_ZSTD
+#include <zstd.h>
+#endif
 
 namespace rtc{
 namespace common
@@ -68,10 +78,389 @@ int AppendFile::flush()
     return ::fflush(pfile_);
 }
 
-LogFile::LogFile(const std::string& file_path,uint64_t roll_size)
+#ifdef RTC_ALOG_USE_IO_URING
+namespace
+{
+enum UringOp : uint64_t {
+    kOpWrite = 1,
+    kOpOpen,
+    kOpFallocate,
+    kOpRoll,
+    kOpClose,
+};
+const int kSegmentOpenFlags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+//roll之后重新创建next时使用O_EXCL: 如果改名没有成功, next仍然是正在写的日志段,
+//不能被O_TRUNC截断
+const int kNextSegmentOpenFlags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+
+inline uint64_t make_user_data(uint64_t op, uint64_t arg)
+{
+    return (op << 32) | arg;
+}
+}
+
+UringAppendFile::UringAppendFile(const std::string& main_name,
+        const std::string& backup_name, uint64_t segment_size)
+    :ring_(new io_uring),
+    fixed_buffers_(false),
+    pool_(new char[kBufferSize * kBufferCount]),
+    pending_len_(kBufferCount, 0),
+    cur_buffer_(-1),
+    cur_len_(0),
+    inflight_(0),
+    main_name_(main_name),
+    backup_name_(backup_name),
+    next_name_(main_name + ".next"),
+    segment_size_(segment_size),
+    next_opening_(false),
+    roll_failed_(false),
+    ring_ready_(false),
+    written_bytes_(0),
+    write_errors_(0)
+{
+    //内核不支持或被seccomp等禁止时初始化失败, 由调用者退化为AppendFile
+    if(io_uring_queue_init(kQueueDepth, ring_.get(), 0) != 0)
+    {
+        return;
+    }
+    ring_ready_ = true;
+
+    std::vector<struct iovec> iovecs(kBufferCount);
+    for(size_t i = 0; i < kBufferCount; i++)
+    {
+        iovecs[i].iov_base = pool_.get() + i * kBufferSize;
+        iovecs[i].iov_len = kBufferSize;
+        free_buffers_.push_back(static_cast<int>(kBufferCount - 1 - i));
+    }
+    //RLIMIT_MEMLOCK不足时注册会失败, 退化为普通的write
+    fixed_buffers_ = io_uring_register_buffers(ring_.get(),
+            iovecs.data(), kBufferCount) == 0;
+
+    //第一个日志段在构造时同步打开, 先以next的名字打开再改名:
+    //打开失败时还没有动过main和backup, 调用者退化为AppendFile时照常切换
+    cur_.fd = ::open(next_name_.c_str(), kSegmentOpenFlags, 0644);
+    if(cur_.fd < 0)
+    {
+        io_uring_queue_exit(ring_.get());
+        ring_ready_ = false;
+        return;
+    }
+    ::fallocate(cur_.fd, FALLOC_FL_KEEP_SIZE, 0,
+            static_cast<off_t>(segment_size_));
+    //rename会原子地替换已有的backup
+    ::rename(main_name_.c_str(), backup_name_.c_str());
+    acquire_buffer();
+    if(::rename(next_name_.c_str(), main_name_.c_str()) != 0)
+    {
+        //正在写的日志段还叫next, 由下次roll补做改名, 不能再以O_TRUNC打开next
+        roll_failed_ = true;
+        return;
+    }
+    open_next_segment();
+}
+
+UringAppendFile::~UringAppendFile()
+{
+    if(!ring_ready_)
+    {
+        return;
+    }
+    submit_buffer();
+    while(inflight_ > 0)
+    {
+        reap(true);
+    }
+    if(cur_.fd >= 0)
+    {
+        //释放预分配但没有用到的空间
+        ::ftruncate(cur_.fd, cur_.offset);
+        ::close(cur_.fd);
+    }
+    if(next_.fd >= 0)
+    {
+        ::close(next_.fd);
+        ::unlink(next_name_.c_str());
+    }
+    io_uring_queue_exit(ring_.get());
+}
+
+void UringAppendFile::append(const char* logline,const size_t len)
+{
+    size_t n = 0;
+    while(n < len)
+    {
+        size_t size = std::min(kBufferSize - cur_len_, len - n);
+        ::memcpy(pool_.get() + cur_buffer_ * kBufferSize + cur_len_,
+                logline + n, size);
+        cur_len_ += size;
+        n += size;
+        if(cur_len_ == kBufferSize)
+        {
+            submit_buffer();
+            acquire_buffer();
+        }
+    }
+    written_bytes_ += static_cast<off_t>(len);
+}
+
+int UringAppendFile::flush()
+{
+    if(cur_len_ > 0)
+    {
+        submit_buffer();
+        acquire_buffer();
+    }
+    else
+    {
+        reap(false);
+    }
+    return 0;
+}
+
+void UringAppendFile::roll()
+{
+    submit_buffer();
+    wait_next_segment();
+    if(next_.fd < 0)
+    {
+        //没有可以切换的日志段, 继续写当前的, 下次roll时再试
+        acquire_buffer();
+        return;
+    }
+
+    //保证整条请求链在同一次submit中提交, 否则链接会被截断
+    if(io_uring_sq_space_left(ring_.get()) < 4)
+    {
+        io_uring_submit(ring_.get());
+    }
+    //已提交的写请求持有文件的引用, 旧日志段可以直接异步close
+    struct io_uring_sqe* sqe = get_sqe();
+    io_uring_prep_close(sqe, cur_.fd);
+    sqe->user_data = make_user_data(kOpClose, 0);
+
+    //rename(main, backup) -> rename(next, main) -> open(next)
+    //rename会原子地替换已有的backup, 不需要先unlink.
+    //任何一步失败时链上后面的请求都被取消(-ECANCELED), 由wait_next_segment补做
+    sqe = get_sqe();
+    io_uring_prep_renameat(sqe, AT_FDCWD, main_name_.c_str(),
+            AT_FDCWD, backup_name_.c_str(), 0);
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe->user_data = make_user_data(kOpRoll, 0);
+
+    sqe = get_sqe();
+    io_uring_prep_renameat(sqe, AT_FDCWD, next_name_.c_str(),
+            AT_FDCWD, main_name_.c_str(), 0);
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe->user_data = make_user_data(kOpRoll, 0);
+
+    sqe = get_sqe();
+    io_uring_prep_openat(sqe, AT_FDCWD, next_name_.c_str(),
+            kNextSegmentOpenFlags, 0644);
+    sqe->user_data = make_user_data(kOpOpen, 0);
+
+    inflight_ += 4;
+    next_opening_ = true;
+    io_uring_submit(ring_.get());
+
+    cur_ = next_;
+    next_ = Segment();
+    written_bytes_ = 0;
+    acquire_buffer();
+}
+
+void UringAppendFile::submit_buffer()
+{
+    if(cur_len_ == 0)
+    {
+        return;
+    }
+    struct io_uring_sqe* sqe = get_sqe();
+    char* buffer = pool_.get() + cur_buffer_ * kBufferSize;
+    if(fixed_buffers_)
+    {
+        io_uring_prep_write_fixed(sqe, cur_.fd, buffer,
+                static_cast<unsigned>(cur_len_), cur_.offset, cur_buffer_);
+    }
+    else
+    {
+        io_uring_prep_write(sqe, cur_.fd, buffer,
+                static_cast<unsigned>(cur_len_), cur_.offset);
+    }
+    sqe->user_data = make_user_data(kOpWrite, static_cast<uint64_t>(cur_buffer_));
+    pending_len_[cur_buffer_] = cur_len_;
+    cur_.offset += static_cast<off_t>(cur_len_);
+    ++inflight_;
+    io_uring_submit(ring_.get());
+
+    cur_buffer_ = -1;
+    cur_len_ = 0;
+}
+
+void UringAppendFile::acquire_buffer()
+{
+    if(cur_buffer_ >= 0)
+    {
+        return;
+    }
+    reap(false);
+    while(free_buffers_.empty())
+    {
+        //所有缓冲区都在等待磁盘, 说明磁盘持续跟不上, 只能等待
+        reap(true);
+    }
+    cur_buffer_ = free_buffers_.back();
+    free_buffers_.pop_back();
+    cur_len_ = 0;
+}
+
+void UringAppendFile::reap(bool wait)
+{
+    struct io_uring_cqe* cqe = nullptr;
+    if(wait && inflight_ > 0 &&
+            io_uring_wait_cqe(ring_.get(), &cqe) == 0)
+    {
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        io_uring_cqe_seen(ring_.get(), cqe);
+        handle_completion(user_data, res);
+    }
+    while(io_uring_peek_cqe(ring_.get(), &cqe) == 0)
+    {
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        io_uring_cqe_seen(ring_.get(), cqe);
+        handle_completion(user_data, res);
+    }
+}
+
+void UringAppendFile::handle_completion(uint64_t user_data, int res)
+{
+    assert(inflight_ > 0);
+    --inflight_;
+    uint64_t arg = user_data & 0xffffffff;
+    switch(user_data >> 32)
+    {
+    case kOpWrite:
+        if(res < 0 || static_cast<size_t>(res) != pending_len_[arg])
+        {
+            ++write_errors_;
+        }
+        free_buffers_.push_back(static_cast<int>(arg));
+        break;
+    case kOpOpen:
+        next_opening_ = false;
+        if(res >= 0)
+        {
+            next_.fd = res;
+            next_.offset = 0;
+            struct io_uring_sqe* sqe = get_sqe();
+            io_uring_prep_fallocate(sqe, res, FALLOC_FL_KEEP_SIZE, 0,
+                    static_cast<off_t>(segment_size_));
+            sqe->user_data = make_user_data(kOpFallocate, 0);
+            ++inflight_;
+            io_uring_submit(ring_.get());
+        }
+        break;
+    case kOpRoll:
+        if(res < 0)
+        {
+            roll_failed_ = true;
+        }
+        break;
+    default:
+        //close/rename/fallocate失败不影响写入(fallocate在tmpfs等上可能不支持)
+        break;
+    }
+}
+
+struct io_uring_sqe* UringAppendFile::get_sqe()
+{
+    struct io_uring_sqe* sqe = io_uring_get_sqe(ring_.get());
+    while(sqe == nullptr)
+    {
+        io_uring_submit(ring_.get());
+        sqe = io_uring_get_sqe(ring_.get());
+    }
+    return sqe;
+}
+
+void UringAppendFile::open_next_segment()
+{
+    struct io_uring_sqe* sqe = get_sqe();
+    io_uring_prep_openat(sqe, AT_FDCWD, next_name_.c_str(),
+            kSegmentOpenFlags, 0644);
+    sqe->user_data = make_user_data(kOpOpen, 0);
+    ++inflight_;
+    next_opening_ = true;
+    io_uring_submit(ring_.get());
+}
+
+void UringAppendFile::wait_next_segment()
+{
+    while(next_opening_)
+    {
+        reap(true);
+    }
+    if(next_.fd >= 0)
+    {
+        return;
+    }
+    if(roll_failed_)
+    {
+        //上次roll的改名没有完成(如main被外部删除), 正在写的日志段还叫next
+        ::rename(main_name_.c_str(), backup_name_.c_str());
+        ::rename(next_name_.c_str(), main_name_.c_str());
+        roll_failed_ = false;
+    }
+    //异步打开失败, 退化为同步打开; 仍然失败时next_.fd < 0, 本次不roll
+    next_.fd = ::open(next_name_.c_str(), kNextSegmentOpenFlags, 0644);
+    next_.offset = 0;
+}
+#endif
+
+#ifdef RTC_ALOG_USE_ZSTD
+FrameCompressor::FrameCompressor(int level)
+    :cctx_(ZSTD_createCCtx())
+{
+    assert(cctx_ != nullptr);
+    ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(cctx_, ZSTD_c_checksumFlag, 1);
+}
+
+FrameCompressor::~FrameCompressor()
+{
+    ZSTD_freeCCtx(cctx_);
+}
+
+const char* FrameCompressor::compress(const char* content,size_t size,
+        size_t* compressed_size)
+{
+    //输出缓冲区只增不减, AsyncLogging每次最多交付一个大缓冲区
+    size_t bound = ZSTD_compressBound(size);
+    if(out_.size() < bound){
+        out_.resize(bound);
+    }
+    //ZSTD_compress2总是输出一个完整的帧, 帧头中带有原始长度
+    size_t ret = ZSTD_compress2(cctx_, out_.data(), out_.size(), content, size);
+    if(ZSTD_isError(ret)){
+        ZSTD_CCtx_reset(cctx_, ZSTD_reset_session_only);
+        return nullptr;
+    }
+    *compressed_size = ret;
+    return out_.data();
+}
+#endif
+
+LogFile::LogFile(const std::string& file_path,uint64_t roll_size,int compress_level)
     :file_path_(file_path),
     roll_size_(roll_size)
 {
+#ifdef RTC_ALOG_USE_ZSTD
+    if(compress_level > 0){
+        compressor_.reset(new FrameCompressor(compress_level));
+    }
+#endif
+    (void) compress_level;
     roll_file();
 }
 
@@ -82,6 +471,28 @@ LogFile::~LogFile()
 
 void LogFile::append(const char* content,size_t size)
 {
+#ifdef RTC_ALOG_USE_ZSTD
+    if(compressor_){
+        //压缩在AsyncLogging的后台线程中进行, 不影响前台append
+        size_t compressed_size = 0;
+        content = compressor_->compress(content,size,&compressed_size);
+        if(content == nullptr){
+            //压缩失败只丢弃这一帧, 不能把明文混进压缩文件
+            return;
+        }
+        size = compressed_size;
+    }
+#endif
+#ifdef RTC_ALOG_USE_IO_URING
+    if(uring_file_){
+        uring_file_->append(content,size);
+        if( static_cast<uint64_t>(uring_file_->written_bytes()) > roll_size_)
+        {
+            roll_file();
+        }
+        return;
+    }
+#endif
     file_->append(content,size);
     if( static_cast<uint64_t>(file_->written_bytes()) > roll_size_)
     {
@@ -91,6 +502,12 @@ void LogFile::append(const char* content,size_t size)
 
 void LogFile::flush()
 {
+#ifdef RTC_ALOG_USE_IO_URING
+    if(uring_file_){
+        uring_file_->flush();
+        return;
+    }
+#endif
     int ret = file_->flush();
     (void) ret;
 }
@@ -99,6 +516,27 @@ void LogFile::roll_file()
 {
     std::string m_file_name = file_path_.empty() ? "rtc.log" : file_path_ + "_rtc.log";
     std::string s_file_name = file_path_.empty() ? "rtc.log" : file_path_ + "_rtc.log.bk";
+#ifdef RTC_ALOG_USE_ZSTD
+    if(compressor_){
+        m_file_name += ".zst";
+        s_file_name += ".zst";
+    }
+#endif
+#ifdef RTC_ALOG_USE_IO_URING
+    if(uring_file_){
+        uring_file_->roll();
+        return;
+    }
+    if(!file_){
+        std::unique_ptr<UringAppendFile> file(
+                new UringAppendFile(m_file_name, s_file_name, roll_size_));
+        if(file->valid()){
+            uring_file_ = std::move(file);
+            return;
+        }
+        //io_uring不可用, 使用标准IO
+    }
+#endif
     if(file_){
         file_->close();
     }
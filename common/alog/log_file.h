@@ -5,6 +5,14 @@
 #include <vector>
 #include <memory>
 
+#ifdef RTC_ALOG_USE_IO_URING
+struct io_uring;
+struct io_uring_sqe;
+#endif
+#ifdef RTC_ALOG_USE_ZSTD
+struct ZSTD_CCtx_s;
+#endif
+
 namespace rtc
 {
 namespace common
@@ -28,9 +36,90 @@ private:
     off_t written_bytes_;
 };
 
+#ifdef RTC_ALOG_USE_IO_URING
+//基于io_uring的日志写入(需要liburing >= 2.1, linux >= 5.15)
+//1) append只把数据拷贝到预先注册的缓冲区(io_uring_register_buffers),
+//   写满后提交write_fixed, 后台线程不等待磁盘
+//2) 每个日志段用fallocate预分配roll_size, 写入时不再扩展文件
+//3) 下一个日志段提前异步打开并预分配, roll时的unlink/rename/open
+//   作为一条链接的请求链异步提交
+//只有当所有缓冲区都在等待磁盘时(磁盘持续慢于日志产生速度)才会阻塞
+class UringAppendFile{
+public:
+    UringAppendFile(const std::string& main_name,
+            const std::string& backup_name, uint64_t segment_size);
+    ~UringAppendFile();
+    void append(const char* logline,const size_t size);
+    //提交未写满的缓冲区, 不等待完成
+    int flush();
+    //切换到预先打开的日志段: main->backup, next->main
+    void roll();
+    off_t written_bytes() const { return written_bytes_;}
+    uint64_t write_errors() const { return write_errors_;}
+    //io_uring初始化失败(内核不支持或被禁止)时为false, 此时不能使用
+    bool valid() const { return ring_ready_;}
+private:
+    static const size_t kBufferSize  = 256 * 1024;
+    static const size_t kBufferCount = 16;
+    static const unsigned kQueueDepth = 64;
+
+    struct Segment{
+        int   fd = -1;
+        off_t offset = 0; //已提交写入的偏移
+    };
+
+    void submit_buffer();
+    void acquire_buffer();
+    void reap(bool wait);
+    void handle_completion(uint64_t user_data, int res);
+    struct io_uring_sqe* get_sqe();
+    void open_next_segment();
+    void wait_next_segment();
+
+    std::unique_ptr<io_uring> ring_;
+    bool                      fixed_buffers_;
+    std::unique_ptr<char[]>   pool_;
+    std::vector<int>          free_buffers_;
+    std::vector<size_t>       pending_len_; //每个缓冲区已提交的写入长度
+    int                       cur_buffer_;
+    size_t                    cur_len_;
+    unsigned                  inflight_;
+
+    std::string main_name_;
+    std::string backup_name_;
+    std::string next_name_;
+    uint64_t    segment_size_;
+
+    Segment  cur_;
+    Segment  next_;
+    bool     next_opening_;
+    bool     roll_failed_; //roll的改名请求链失败
+    bool     ring_ready_;
+    off_t    written_bytes_;
+    uint64_t write_errors_;
+};
+#endif
+
+#ifdef RTC_ALOG_USE_ZSTD
+//每次append的数据压缩成一个独立的zstd帧, 日志段就是多个帧的拼接:
+//可以直接用zstd -d解压, 也可以从任意一个帧的边界开始解压
+class FrameCompressor{
+public:
+    explicit FrameCompressor(int level);
+    ~FrameCompressor();
+    //返回的数据在下一次调用前有效, 失败时返回nullptr
+    const char* compress(const char* content,size_t size,size_t* compressed_size);
+private:
+    ZSTD_CCtx_s*      cctx_;
+    std::vector<char> out_;
+};
+#endif
+
 class LogFile{
 public:
-    LogFile(const std::string& file_path,uint64_t roll_size);
+    //compress_level > 0 时使用zstd压缩日志段(需要RTC_ALOG_USE_ZSTD),
+    //此时roll_size按压缩后的字节数计算
+    LogFile(const std::string& file_path,uint64_t roll_size,int compress_level = 0);
     ~LogFile();
     void append(const char* content,size_t size);
     void flush();
@@ -38,7 +127,13 @@ public:
 private:
     std::string file_path_;
     uint64_t    roll_size_;
-    std::unique_ptr<AppendFile> file_;
+#ifdef RTC_ALOG_USE_IO_URING
+    std::unique_ptr<UringAppendFile> uring_file_;
+#endif
+    std::unique_ptr<AppendFile> file_; //不使用io_uring或io_uring不可用时
+#ifdef RTC_ALOG_USE_ZSTD
+    std::unique_ptr<FrameCompressor> compressor_;
+#endif
 };
 
 }
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <rtc/common/alog/log_file.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+std::string read_file(const std::string& name)
+{
+    std::ifstream in(name, std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+bool file_exists(const std::string& name)
+{
+    return ::access(name.c_str(), F_OK) == 0;
+}
+
+class LogFileTest : public testing::Test {
+public:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/log_file_test_XXXXXX";
+        ASSERT_NE(nullptr, ::mkdtemp(dir));
+        dir_ = dir;
+        path_ = dir_ + "/test";
+        main_ = path_ + "_rtc.log";
+        backup_ = path_ + "_rtc.log.bk";
+    }
+
+    void TearDown() override
+    {
+        ::remove(main_.c_str());
+        ::remove(backup_.c_str());
+        ::remove((main_ + ".next").c_str());
+        ::rmdir(dir_.c_str());
+    }
+protected:
+    std::string dir_;
+    std::string path_;
+    std::string main_;
+    std::string backup_;
+};
+}
+
+TEST_F(LogFileTest, RollsToBackup)
+{
+    const std::string a(40, 'a');
+    const std::string b(40, 'b');
+    const std::string c(10, 'c');
+    {
+        rtc::common::LogFile file(path_, 64);
+        file.append(a.data(), a.size());
+        file.append(b.data(), b.size()); //超过roll_size, 切换日志段
+        file.append(c.data(), c.size());
+    }
+    EXPECT_EQ(c, read_file(main_));
+    EXPECT_EQ(a + b, read_file(backup_));
+    EXPECT_FALSE(file_exists(main_ + ".next"));
+}
+
+TEST_F(LogFileTest, RollsRepeatedly)
+{
+    const std::string line(50, 'x');
+    {
+        rtc::common::LogFile file(path_, 64);
+        for(int i = 0; i < 6; i++)
+        {
+            file.append(line.data(), line.size());
+        }
+        file.flush();
+    }
+    //每两行roll一次, 最后一次roll之后没有再写入
+    EXPECT_EQ("", read_file(main_));
+    EXPECT_EQ(line + line, read_file(backup_));
+}
+
+TEST_F(LogFileTest, RollSurvivesDeletedSegment)
+{
+    const std::string a(80, 'a');
+    const std::string b(80, 'b');
+    const std::string c(10, 'c');
+    {
+        rtc::common::LogFile file(path_, 64);
+        ::remove(main_.c_str());
+        file.append(a.data(), a.size()); //main已被删除, 这次roll的改名失败
+        file.append(b.data(), b.size());
+        file.append(c.data(), c.size());
+    }
+    EXPECT_EQ(c, read_file(main_));
+    EXPECT_EQ(b, read_file(backup_));
+}
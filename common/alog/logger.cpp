@@ -28,12 +28,12 @@ static Logger::FlushFunc g_flash = std::bind(default_flush);
 
 static std::shared_ptr<AsyncLogging> asyn_logger = nullptr;
 
-void rtc_log_init(const char* log_file_path,uint64_t rollsize)
+void rtc_log_init(const char* log_file_path,uint64_t rollsize,int compress_level)
 {
     std::string real_path(log_file_path);
     if(rollsize < 1024 * 1024)
         rollsize = 1024 * 1024;
-    asyn_logger.reset(new AsyncLogging(real_path,rollsize));
+    asyn_logger.reset(new AsyncLogging(real_path,rollsize,compress_level));
     g_output = std::bind(&AsyncLogging::append,asyn_logger.get(),_1,_2);
 }
 void rtc_log_uinit()
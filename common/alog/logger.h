@@ -14,7 +14,8 @@ namespace common
 namespace alog
 {
 
-void rtc_log_init(const char* log_file_path = "./", uint64_t rollsize=1024*1024);
+void rtc_log_init(const char* log_file_path = "./", uint64_t rollsize=1024*1024,
+        int compress_level = 0);
 void rtc_log_uinit();
 std::string cut_slash(const char* path,size_t num);
 std::string dump(const uint8_t* data,size_t len, size_t print);
@@ -0,0 +1,127 @@
+#ifndef BBR_COMMON_GAIN_H_
+#define BBR_COMMON_GAIN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <common/rate.h>
+#include <time/interval.h>
+
+namespace bbr
+{
+namespace common
+{
+// Fixed point multiplier, scaled by kUnit like BBR_UNIT in tcp_bbr.c but with
+// a finer scale so that fractions such as 1% keep their value.
+// Only the (constexpr) construction from a floating point number converts,
+// applying a gain is integer math with 128-bit intermediates, which gives
+// the same result on every compiler and architecture.
+class Gain
+{
+public:
+    static constexpr int kScale = 16;
+    static constexpr int64_t kUnit = int64_t(1) << kScale;
+
+    constexpr explicit Gain(double gain)
+        :raw_(static_cast<int64_t>(gain * kUnit + (gain < 0 ? -0.5 : 0.5)))
+    {}
+
+    static constexpr Gain from_raw(int64_t raw) {
+        Gain gain(0.0);
+        gain.raw_ = raw;
+        return gain;
+    }
+    static constexpr Gain one() { return from_raw(kUnit);}
+
+    constexpr int64_t raw() const { return raw_;}
+    // For logging only.
+    constexpr double to_double() const { return raw_ * 1.0 / kUnit;}
+
+private:
+    int64_t raw_;
+};
+
+inline constexpr bool operator == (const Gain g1, const Gain g2)
+{
+    return g1.raw() == g2.raw();
+}
+
+inline constexpr bool operator != (const Gain g1, const Gain g2)
+{
+    return g1.raw() != g2.raw();
+}
+
+inline constexpr bool operator < (const Gain g1, const Gain g2)
+{
+    return g1.raw() < g2.raw();
+}
+
+inline constexpr bool operator > (const Gain g1, const Gain g2)
+{
+    return g1.raw() > g2.raw();
+}
+
+inline constexpr Gain operator + (const Gain g1, const Gain g2)
+{
+    return Gain::from_raw(g1.raw() + g2.raw());
+}
+
+inline constexpr Gain operator - (const Gain g1, const Gain g2)
+{
+    return Gain::from_raw(g1.raw() - g2.raw());
+}
+
+//truncated, as the float multiplication converted back to an integer was
+inline constexpr size_t operator * (const size_t value, const Gain gain)
+{
+    __int128 product = static_cast<__int128>(value) * gain.raw() / Gain::kUnit;
+    if (product < 0) {
+        return 0;
+    }
+    if (product > static_cast<__int128>(std::numeric_limits<size_t>::max())) {
+        return std::numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(product);
+}
+
+inline constexpr size_t operator * (const Gain gain, const size_t value)
+{
+    return value * gain;
+}
+
+//infinite rates stay infinite
+inline constexpr BitRate operator * (const BitRate rate, const Gain gain)
+{
+    if (!rate.is_valid()) {
+        return rate;
+    }
+    return BitRate(static_cast<int64_t>(
+            static_cast<__int128>(rate.value()) * gain.raw() / Gain::kUnit));
+}
+
+inline constexpr BitRate operator * (const Gain gain, const BitRate rate)
+{
+    return rate * gain;
+}
+}
+
+namespace time
+{
+//rounded, infinite deltas stay infinite
+inline constexpr TimeDelta operator * (const TimeDelta dt, const common::Gain gain)
+{
+    if (!dt.is_valid()) {
+        return dt;
+    }
+    __int128 scaled = static_cast<__int128>(dt.value()) * gain.raw();
+    scaled += scaled < 0 ? -common::Gain::kUnit / 2 : common::Gain::kUnit / 2;
+    return TimeDelta(static_cast<int64_t>(scaled / common::Gain::kUnit));
+}
+
+inline constexpr TimeDelta operator * (const common::Gain gain, const TimeDelta dt)
+{
+    return dt * gain;
+}
+}
+}
+#endif
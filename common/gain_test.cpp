@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <common/gain.h>
+
+using Gain = bbr::common::Gain;
+using BitRate = bbr::common::BitRate;
+using TimeDelta = bbr::time::TimeDelta;
+using namespace bbr::common::rate;
+using namespace bbr::time;
+
+TEST(GainTest, FixedPoint)
+{
+    EXPECT_EQ(Gain::kUnit, Gain::one().raw());
+    EXPECT_EQ(Gain::kUnit / 4, Gain(0.25).raw());
+    EXPECT_EQ(Gain(0.7), Gain::one() - Gain(0.3));
+    EXPECT_NEAR(2.885, Gain(2.885).to_double(), 1.0 / Gain::kUnit);
+    EXPECT_TRUE(Gain(1.25) > Gain::one());
+}
+
+TEST(GainTest, Apply)
+{
+    EXPECT_EQ(1250u, size_t(1000) * Gain(1.25));
+    // 0.01 is kept as 655 / kUnit, the product is truncated.
+    EXPECT_EQ(655, Gain(0.01).raw());
+    EXPECT_EQ(9994u, size_t(1000 * 1000) * Gain(0.01));
+
+    EXPECT_EQ(BitRate(750 * 1000), BitRate(1000 * 1000) * Gain(0.75));
+    EXPECT_EQ(BitRate::positive_infinity(),
+            BitRate::positive_infinity() * Gain(0.75));
+
+    EXPECT_EQ(15_ms, 10_ms * Gain(1.5));
+    EXPECT_EQ(TimeDelta::positive_infinity(),
+            TimeDelta::positive_infinity() * Gain(0.5));
+}
+
+TEST(GainTest, IntegerRateMath)
+{
+    // Literals, infinities and the rate math fold at compile time.
+    static_assert(1_mbps == BitRate(1024 * 1024), "");
+    static_assert(!BitRate::positive_infinity().is_valid(), "");
+    static_assert(!TimeDelta().is_valid(), "");
+    static_assert(size_t(1000) / 1_ms == BitRate(8 * 1000 * 1000), "");
+    static_assert(10_ms * Gain(1.5) == 15_ms, "");
+
+    EXPECT_EQ(BitRate(1280 * 8 * 100), size_t(1280) / 10_ms);
+    // Truncated.
+    EXPECT_EQ(BitRate(2666666), size_t(1000) / 3_ms);
+    EXPECT_EQ(BitRate::positive_infinity(), size_t(1000) / TimeDelta(0));
+
+    // Rounded.
+    EXPECT_EQ(3_ms, size_t(1000) / BitRate(2666666));
+    EXPECT_EQ(10 * 1000u, BitRate(1000 * 1000) * 10_ms);
+    EXPECT_EQ(0u, BitRate(1000 * 1000) * TimeDelta(-1));
+}
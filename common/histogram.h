@@ -0,0 +1,128 @@
+#ifndef BBR_COMMON_HISTOGRAM_H_
+#define BBR_COMMON_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+namespace bbr
+{
+namespace common
+{
+// HDR-style log-linear histogram with a fixed number of buckets.
+// Values below 2^kSubBucketBits are recorded exactly, above that every
+// power of two is split into kSubBucketHalfCount buckets, which keeps the
+// relative error below 1 / kSubBucketHalfCount (~3%).
+// Values larger than kMaxValue are clamped into the last bucket.
+class HdrHistogram
+{
+public:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr int kMaxValueBits = 40;
+    static constexpr uint64_t kMaxValue = (1ull << kMaxValueBits) - 1;
+    static constexpr size_t kSubBucketCount = 1u << kSubBucketBits;
+    static constexpr size_t kSubBucketHalfCount = kSubBucketCount / 2;
+    static constexpr size_t kBucketCount = kSubBucketCount +
+            (kMaxValueBits - kSubBucketBits) * kSubBucketHalfCount;
+
+    // O(1), no allocation.
+    void record(uint64_t value) {
+        value = std::min(value, kMaxValue);
+        counts_[index(value)]++;
+        total_count_++;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // Histograms of different connections can be merged into one.
+    void merge(const HdrHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; i++) {
+            counts_[i] += other.counts_[i];
+        }
+        total_count_ += other.total_count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() {
+        std::fill(counts_, counts_ + kBucketCount, 0);
+        total_count_ = 0;
+        min_ = std::numeric_limits<uint64_t>::max();
+        max_ = 0;
+    }
+
+    uint64_t count() const { return total_count_;}
+    uint64_t min() const { return total_count_ ? min_ : 0;}
+    uint64_t max() const { return max_;}
+
+    // The highest value equivalent to the one at |percentile| (0 - 100),
+    // i.e. the result never underestimates the real percentile.
+    uint64_t percentile(double percentile) const {
+        if (total_count_ == 0) {
+            return 0;
+        }
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t target = static_cast<uint64_t>(
+                percentile / 100.0 * total_count_ + 0.5);
+        target = std::max<uint64_t>(target, 1);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; i++) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(highest_equivalent_value(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    static size_t index(uint64_t value) {
+        if (value < kSubBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        int shift = most_significant_bit(value) - kSubBucketBits + 1;
+        return kSubBucketCount + (shift - 1) * kSubBucketHalfCount +
+                static_cast<size_t>((value >> shift) - kSubBucketHalfCount);
+    }
+
+    static uint64_t lowest_equivalent_value(size_t idx) {
+        if (idx < kSubBucketCount) {
+            return idx;
+        }
+        int shift = static_cast<int>((idx - kSubBucketCount) / kSubBucketHalfCount) + 1;
+        uint64_t sub_bucket = (idx - kSubBucketCount) % kSubBucketHalfCount
+                + kSubBucketHalfCount;
+        return sub_bucket << shift;
+    }
+
+    static uint64_t highest_equivalent_value(size_t idx) {
+        if (idx < kSubBucketCount) {
+            return idx;
+        }
+        int shift = static_cast<int>((idx - kSubBucketCount) / kSubBucketHalfCount) + 1;
+        return lowest_equivalent_value(idx) + (1ull << shift) - 1;
+    }
+
+private:
+    static int most_significant_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(value);
+#else
+        int msb = 0;
+        while (value >>= 1) {
+            msb++;
+        }
+        return msb;
+#endif
+    }
+
+private:
+    uint64_t counts_[kBucketCount] = {0};
+    uint64_t total_count_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+}
+}
+#endif
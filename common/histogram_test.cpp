@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <common/histogram.h>
+
+using HdrHistogram = bbr::common::HdrHistogram;
+
+TEST(HdrHistogramTest, SmallValuesAreExact)
+{
+    HdrHistogram histogram;
+    for (uint64_t i = 0; i < HdrHistogram::kSubBucketCount; i++) {
+        EXPECT_EQ(i, HdrHistogram::index(i));
+        EXPECT_EQ(i, HdrHistogram::lowest_equivalent_value(i));
+        EXPECT_EQ(i, HdrHistogram::highest_equivalent_value(i));
+    }
+}
+
+TEST(HdrHistogramTest, BucketsCoverAllValues)
+{
+    EXPECT_EQ(HdrHistogram::kBucketCount - 1,
+            HdrHistogram::index(HdrHistogram::kMaxValue));
+    // Buckets are contiguous and every value falls into its own bucket.
+    for (size_t i = 1; i < HdrHistogram::kBucketCount; i++) {
+        EXPECT_EQ(HdrHistogram::highest_equivalent_value(i - 1) + 1,
+                HdrHistogram::lowest_equivalent_value(i)) << "i:" << i;
+    }
+    for (uint64_t value = 1; value < HdrHistogram::kMaxValue; value = value * 3 + 1) {
+        size_t idx = HdrHistogram::index(value);
+        EXPECT_LE(HdrHistogram::lowest_equivalent_value(idx), value);
+        EXPECT_GE(HdrHistogram::highest_equivalent_value(idx), value);
+    }
+}
+
+TEST(HdrHistogramTest, RelativeError)
+{
+    HdrHistogram histogram;
+    for (uint64_t value = 100; value < 1000 * 1000 * 1000; value = value * 7 / 5) {
+        size_t idx = HdrHistogram::index(value);
+        uint64_t width = HdrHistogram::highest_equivalent_value(idx) -
+                HdrHistogram::lowest_equivalent_value(idx) + 1;
+        EXPECT_LE(width * 1.0 / value, 1.0 / HdrHistogram::kSubBucketHalfCount);
+    }
+}
+
+TEST(HdrHistogramTest, Percentiles)
+{
+    HdrHistogram histogram;
+    EXPECT_EQ(0u, histogram.percentile(99));
+    // 1ms .. 100ms in 1ms steps.
+    for (uint64_t rtt_us = 1000; rtt_us <= 100 * 1000; rtt_us += 1000) {
+        histogram.record(rtt_us);
+    }
+    EXPECT_EQ(100u, histogram.count());
+    EXPECT_EQ(1000u, histogram.min());
+    EXPECT_EQ(100 * 1000u, histogram.max());
+
+    uint64_t p50 = histogram.percentile(50);
+    EXPECT_GE(p50, 50 * 1000u);
+    EXPECT_LE(p50, 50 * 1000u * (1 + 1.0 / HdrHistogram::kSubBucketHalfCount));
+    uint64_t p99 = histogram.percentile(99);
+    EXPECT_GE(p99, 99 * 1000u);
+    EXPECT_LE(p99, 100 * 1000u);
+    EXPECT_EQ(histogram.max(), histogram.percentile(100));
+}
+
+TEST(HdrHistogramTest, Merge)
+{
+    HdrHistogram a;
+    HdrHistogram b;
+    for (uint64_t i = 1; i <= 50; i++) {
+        a.record(i);
+        b.record(i + 50);
+    }
+    a.merge(b);
+    EXPECT_EQ(100u, a.count());
+    EXPECT_EQ(1u, a.min());
+    EXPECT_EQ(100u, a.max());
+    EXPECT_GE(a.percentile(50), 50u);
+    EXPECT_LE(a.percentile(50), 51u);
+
+    a.reset();
+    EXPECT_EQ(0u, a.count());
+    EXPECT_EQ(0u, a.min());
+    EXPECT_EQ(0u, a.max());
+}
+
+TEST(HdrHistogramTest, ClampsLargeValues)
+{
+    HdrHistogram histogram;
+    histogram.record(std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(HdrHistogram::kMaxValue, histogram.max());
+    EXPECT_EQ(HdrHistogram::kMaxValue, histogram.percentile(50));
+}
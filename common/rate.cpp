@@ -34,34 +34,5 @@ std::string BitRate::to_str()const
 
     return std::string(buf) + unit;
 }
-
-BitRate BitRate::positive_infinity()
-{
-    return BitRate(std::numeric_limits<int64_t>::max());
-}
-
-BitRate BitRate::negative_infinity()
-{
-    return BitRate(std::numeric_limits<int64_t>::min());
-}
-
-namespace rate{
-
-BitRate operator"" _bps(unsigned long long h)
-{
-    return BitRate(static_cast<int64_t>(h));
-}
-
-BitRate operator"" _kbps(unsigned long long k)
-{
-    return 1024_bps * k;
-}
-
-BitRate operator"" _mbps(unsigned long long m)
-{
-    return 1024_kbps * m;
-}
-
-}
 }
 }
@@ -16,17 +16,19 @@ namespace common
 class BitRate
 {
 public:
-    explicit BitRate(int64_t rate = positive_infinity().value())
+    static constexpr int64_t kPlusInfinity = std::numeric_limits<int64_t>::max();
+    static constexpr int64_t kMinusInfinity = std::numeric_limits<int64_t>::min();
+
+    constexpr explicit BitRate(int64_t rate = kPlusInfinity)
         :bit_rate_(rate)
     {}
-    int64_t value() const { return bit_rate_;}
-    bool is_valid() const{ 
-        return value() != positive_infinity().value()
-            && value() != negative_infinity().value();
+    constexpr int64_t value() const { return bit_rate_;}
+    constexpr bool is_valid() const{
+        return value() != kPlusInfinity && value() != kMinusInfinity;
     }
 
-    static BitRate positive_infinity();
-    static BitRate negative_infinity();
+    static constexpr BitRate positive_infinity() { return BitRate(kPlusInfinity);}
+    static constexpr BitRate negative_infinity() { return BitRate(kMinusInfinity);}
 
     std::string to_str()const;
 private:
@@ -35,38 +37,38 @@ private:
 
 using BandWidth = BitRate;
 
-inline bool operator == (const BitRate d1,const BitRate d2)
+inline constexpr bool operator == (const BitRate d1,const BitRate d2)
 {
     return d1.value() == d2.value();
 }
 
-inline bool operator != (const BitRate d1,const BitRate d2)
+inline constexpr bool operator != (const BitRate d1,const BitRate d2)
 {
     return !(d1 == d2);
 }
 
-inline bool operator < (const BitRate d1,const BitRate d2)
+inline constexpr bool operator < (const BitRate d1,const BitRate d2)
 {
     return d1.value() < d2.value();
 }
 
-inline bool operator <= (const BitRate d1,const BitRate d2)
+inline constexpr bool operator <= (const BitRate d1,const BitRate d2)
 {
     return d1.value() <= d2.value();
 }
 
-inline bool operator > (const BitRate d1,const BitRate d2)
+inline constexpr bool operator > (const BitRate d1,const BitRate d2)
 {
     return d1.value() > d2.value();
 }
 
-inline bool operator >= (const BitRate d1,const BitRate d2)
+inline constexpr bool operator >= (const BitRate d1,const BitRate d2)
 {
     return d1.value() >= d2.value();
 }
 
 template<typename T>
-inline BitRate operator + (const BitRate d1,const T d2)
+inline constexpr BitRate operator + (const BitRate d1,const T d2)
 {
     //不允许使用 1_bps + 1 = 2_bps等乱七八糟的操作
     //正确用法师 1_bps + 1_bps = 2_bps
@@ -75,14 +77,14 @@ inline BitRate operator + (const BitRate d1,const T d2)
 }
 
 template<typename T>
-inline BitRate operator - (const BitRate d1,const T d2)
+inline constexpr BitRate operator - (const BitRate d1,const T d2)
 {
     static_assert(!std::is_integral<T>::value,"1_ms - 1 is not allowed"); 
     return BitRate(d1.value() - d2.value());
 }
 
 template<typename T>
-inline BitRate operator * (const BitRate d1,const T d2)
+inline constexpr BitRate operator * (const BitRate d1,const T d2)
 {
     //不允许 3_bps * 2_bps 等乱七八糟的操作
     static_assert(std::is_integral<T>::value |
@@ -91,13 +93,13 @@ inline BitRate operator * (const BitRate d1,const T d2)
 }
 
 template<typename T>
-inline BitRate operator * (const T d2, const BitRate d1)
+inline constexpr BitRate operator * (const T d2, const BitRate d1)
 {
     return d1 * d2;
 }
 
 template<typename T>
-inline BitRate operator / (const BitRate d1, const T d2)
+inline constexpr BitRate operator / (const BitRate d1, const T d2)
 {
     static_assert(std::is_integral<T>::value |
             std::is_floating_point<T>::value, "integral or float is required"); 
@@ -108,7 +110,7 @@ inline BitRate operator / (const BitRate d1, const T d2)
 }
 //允许使用: 
 //      1_mps / 1_kbps = 1000;
-inline double operator / (const BitRate d1, const BitRate d2)
+inline constexpr double operator / (const BitRate d1, const BitRate d2)
 {
     return d1.value() * 1.0 / d2.value();
 }
@@ -116,9 +118,20 @@ inline double operator / (const BitRate d1, const BitRate d2)
 namespace rate
 {
 //user-defined literals 
-BitRate operator"" _bps(unsigned long long b);
-BitRate operator"" _kbps(unsigned long long k);
-BitRate operator"" _mbps(unsigned long long m);
+inline constexpr BitRate operator"" _bps(unsigned long long b)
+{
+    return BitRate(static_cast<int64_t>(b));
+}
+
+inline constexpr BitRate operator"" _kbps(unsigned long long k)
+{
+    return BitRate(static_cast<int64_t>(k) * 1024);
+}
+
+inline constexpr BitRate operator"" _mbps(unsigned long long m)
+{
+    return BitRate(static_cast<int64_t>(m) * 1024 * 1024);
+}
 }
 }
 }
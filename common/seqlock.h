@@ -0,0 +1,70 @@
+#ifndef BBR_COMMON_SEQLOCK_H_
+#define BBR_COMMON_SEQLOCK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+namespace bbr
+{
+namespace common
+{
+// Single writer, multiple readers. The writer never blocks or waits for
+// readers; readers retry while a store is in progress.
+// The value is kept as relaxed atomic words so that concurrent copies are
+// not data races.
+template <typename ValueType>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+            "SeqLock requires a trivially copyable type");
+    static const size_t kWords = (sizeof(ValueType) + sizeof(uint64_t) - 1)
+            / sizeof(uint64_t);
+public:
+    SeqLock() {
+        store(ValueType());
+    }
+
+    // Must only be called from the owning (writer) thread.
+    void store(const ValueType& value) {
+        uint64_t words[kWords] = {0};
+        std::memcpy(words, &value, sizeof(ValueType));
+
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Can be called from any thread.
+    ValueType load() const {
+        uint64_t words[kWords];
+        uint32_t seq0 = 0;
+        uint32_t seq1 = 0;
+        do {
+            seq0 = seq_.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWords; i++) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq1 = seq_.load(std::memory_order_relaxed);
+        } while ((seq0 & 1) || seq0 != seq1);
+
+        ValueType value;
+        std::memcpy(&value, words, sizeof(ValueType));
+        return value;
+    }
+
+private:
+    // Keep readers' cache line traffic away from the writer's other members.
+    alignas(64) std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> words_[kWords];
+};
+}
+}
+#endif
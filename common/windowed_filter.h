@@ -1,6 +1,12 @@
 #ifndef BBR_WINDOWED_FILTER_H_
 #define BBR_WINDOWED_FILTER_H_
 
+template <class T>
+struct MinFilter
+{
+  bool operator()(const T& lhs, const T& rhs) const { return lhs <= rhs; }
+};
+
 template <class T>
 struct MaxFilter
 {
@@ -59,7 +65,7 @@ class WindowedFilter
       return;
     }
     if (estimates_[1].sample == estimates_[0].sample &&
-        new_time - estimates_[1].time > window_length_ >> 2) {
+        new_time - estimates_[1].time > window_length_ / 4) {
       // A quarter of the window has passed without a better sample, so the
       // second-best estimate is taken from the second quarter of the window.
       estimates_[2] = estimates_[1] = Sample(new_sample, new_time);
@@ -67,7 +73,7 @@ class WindowedFilter
     }
 
     if (estimates_[2].sample == estimates_[1].sample &&
-        new_time - estimates_[2].time > window_length_ >> 1) {
+        new_time - estimates_[2].time > window_length_ / 2) {
       // We've passed a half of the window without a better estimate, so take
       // a third-best estimate from the second half of the window.
       estimates_[2] = Sample(new_sample, new_time);
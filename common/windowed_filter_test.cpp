@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include <time/timestamp.h>
+#include <common/windowed_filter.h>
+
+using TimeDelta = bbr::time::TimeDelta;
+using Timestamp = bbr::time::Timestamp;
+using namespace bbr::time;
+using MinRttFilter = WindowedFilter<TimeDelta, MinFilter<TimeDelta>,
+      Timestamp, TimeDelta>;
+
+TEST(WindowedFilterTest, MinRttExpiresAfterWindow)
+{
+    MinRttFilter filter(10000_ms, TimeDelta::positive_infinity(), Timestamp());
+    Timestamp now(0);
+    filter.update(20_ms, now);
+    EXPECT_EQ(20_ms, filter.get_best());
+
+    // Higher samples do not replace the minimum within the window...
+    for (int i = 0; i < 9; i++) {
+        now += 1000_ms;
+        filter.update(30_ms + TimeDelta(i * 1000), now);
+        EXPECT_EQ(20_ms, filter.get_best());
+    }
+    filter.update(25_ms, now);
+    EXPECT_EQ(20_ms, filter.get_best());
+
+    // ...but it slides up once the window has passed.
+    now += 1500_ms;
+    filter.update(40_ms, now);
+    EXPECT_LT(20_ms, filter.get_best());
+    EXPECT_GE(40_ms, filter.get_best());
+
+    filter.update(10_ms, now);
+    EXPECT_EQ(10_ms, filter.get_best());
+}
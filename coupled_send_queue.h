@@ -0,0 +1,151 @@
+#ifndef BBR_COUPLED_SEND_QUEUE_H_
+#define BBR_COUPLED_SEND_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <packet_buffer.h>
+
+namespace bbr
+{
+// SendQueue of a BasicBbrSender shared by several streams to the same peer
+// (coupled congestion control): the streams share one BbrAlgorithm, hence
+// one cwnd, one pacing rate and one probing cycle, instead of N senders
+// competing in the bottleneck queue and probing N times as hard.
+// Every stream buffers in its own StreamQueue, when cwnd opens the packets
+// are taken by deficit round robin so that each backlogged stream gets a
+// share of the cwnd proportional to its weight.
+//
+// SendingPacket::stream_id tells the stream of a packet. The streams share
+// the sequence number space of the sender.
+// Not thread safe, like the sender.
+template <typename StreamQueue = PacketBuffer>
+class BasicCoupledSendQueue
+{
+public:
+    using Packet = typename StreamQueue::Packet;
+    using StreamId = uint32_t;
+
+    // Bytes a stream of weight 1 may send per round, one full sized packet
+    // (Bbrparams::kDefaultTCPMSS).
+    static const size_t kQuantum = 1460;
+
+    // |weight| must be at least 1. Ids of removed streams are reused.
+    StreamId add_stream(uint32_t weight = 1) {
+        assert(weight > 0);
+        for (size_t i = 0; i < streams_.size(); i++) {
+            if (streams_[i].weight == 0) {
+                streams_[i].weight = weight;
+                streams_[i].deficit = 0;
+                return static_cast<StreamId>(i);
+            }
+        }
+        streams_.emplace_back();
+        streams_.back().weight = weight;
+        return static_cast<StreamId>(streams_.size() - 1);
+    }
+
+    // Drops the packets the stream still buffers.
+    void remove_stream(StreamId id) {
+        Stream& stream = streams_.at(id);
+        size_ -= stream.queue.size();
+        stream.queue.clear();
+        stream.weight = 0;
+        stream.deficit = 0;
+    }
+
+    void set_weight(StreamId id, uint32_t weight) {
+        assert(weight > 0 && streams_.at(id).weight > 0);
+        streams_.at(id).weight = weight;
+    }
+
+    size_t stream_size(StreamId id) const { return streams_.at(id).queue.size();}
+
+    //insert pkt if not exist, into the queue of pkt.stream_id
+    void insert(Packet&& pkt) {
+        Stream& stream = streams_.at(pkt.pkt.stream_id);
+        assert(stream.weight > 0);
+        size_t before = stream.queue.size();
+        stream.queue.insert(std::move(pkt));
+        size_ += stream.queue.size() - before;
+    }
+
+    Packet get(uint64_t seq_no) {
+        for (auto& stream : streams_) {
+            Packet pkt = stream.queue.get(seq_no);
+            if (pkt.valid) {
+                return pkt;
+            }
+        }
+        return Packet();
+    }
+
+    // The next packet of the schedule, the queue must not be empty.
+    Packet pop() {
+        Stream& stream = streams_[select()];
+        Packet pkt = stream.queue.pop();
+        stream.deficit -= pkt.pkt.size;
+        size_--;
+        if (stream.queue.size() == 0) {
+            stream.deficit = 0;
+        }
+        return pkt;
+    }
+
+    // What pop() returns next.
+    Packet& front() {
+        return streams_[select()].queue.front();
+    }
+
+    size_t size() const { return size_;}
+
+    // Drops all packets, keeps the streams and the allocated memory.
+    void clear() {
+        for (auto& stream : streams_) {
+            stream.queue.clear();
+            stream.deficit = 0;
+        }
+        size_ = 0;
+    }
+
+    // Frees the allocated memory of an empty queue.
+    void release_memory() {
+        for (auto& stream : streams_) {
+            stream.queue.release_memory();
+        }
+    }
+
+private:
+    struct Stream
+    {
+        StreamQueue queue;
+        uint32_t weight = 0; //0 if removed
+        size_t deficit = 0;
+    };
+
+    // Stays on the current stream while its deficit covers its next packet,
+    // the next stream is credited its quantum when the turn passes to it.
+    size_t select() {
+        assert(size_ > 0);
+        for (;;) {
+            Stream& stream = streams_[current_];
+            if (stream.queue.size() == 0) {
+                stream.deficit = 0;
+            } else if (stream.deficit >= stream.queue.front().pkt.size) {
+                return current_;
+            }
+            current_ = (current_ + 1) % streams_.size();
+            Stream& next = streams_[current_];
+            next.deficit += next.weight * kQuantum;
+        }
+    }
+
+    std::vector<Stream> streams_;
+    size_t current_ = 0;
+    size_t size_ = 0;
+};
+
+using CoupledSendQueue = BasicCoupledSendQueue<>;
+}
+#endif
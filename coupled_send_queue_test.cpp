@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <coupled_send_queue.h>
+
+using SendingPacket = bbr::SendingPacket;
+
+namespace
+{
+// FIFO with PacketBuffer's interface.
+class FifoQueue
+{
+public:
+    struct Packet {
+        bool valid = false;
+        SendingPacket pkt;
+    };
+    void insert(Packet&& pkt) { pkts_.push_back(std::move(pkt));}
+    Packet get(uint64_t seq_no) {
+        for (const auto& pkt : pkts_) {
+            if (pkt.pkt.seq_no == seq_no) {
+                return pkt;
+            }
+        }
+        return Packet();
+    }
+    Packet pop() {
+        Packet pkt = std::move(pkts_.front());
+        pkts_.pop_front();
+        return pkt;
+    }
+    Packet& front() { return pkts_.front();}
+    size_t size() const { return pkts_.size();}
+    void clear() { pkts_.clear();}
+    void release_memory() { pkts_.shrink_to_fit();}
+
+private:
+    std::deque<Packet> pkts_;
+};
+
+using CoupledSendQueue = bbr::BasicCoupledSendQueue<FifoQueue>;
+
+CoupledSendQueue::Packet make_packet(uint64_t seq_no, uint32_t stream_id,
+        size_t size = 1460)
+{
+    CoupledSendQueue::Packet pkt;
+    pkt.valid = true;
+    pkt.pkt.seq_no = seq_no;
+    pkt.pkt.stream_id = stream_id;
+    pkt.pkt.size = size;
+    return pkt;
+}
+}
+
+TEST(CoupledSendQueueTest, SharesByWeight)
+{
+    CoupledSendQueue queue;
+    auto light = queue.add_stream(1);
+    auto heavy = queue.add_stream(3);
+    uint64_t seq_no = 1;
+    for (int i = 0; i < 40; i++) {
+        queue.insert(make_packet(seq_no++, light));
+        queue.insert(make_packet(seq_no++, heavy));
+    }
+    EXPECT_EQ(80u, queue.size());
+    EXPECT_EQ(40u, queue.stream_size(light));
+
+    size_t sent[2] = {0, 0};
+    for (int i = 0; i < 40; i++) {
+        EXPECT_EQ(queue.front().pkt.seq_no, queue.get(queue.front().pkt.seq_no).pkt.seq_no);
+        sent[queue.pop().pkt.stream_id]++;
+    }
+    EXPECT_EQ(10u, sent[light]);
+    EXPECT_EQ(30u, sent[heavy]);
+    EXPECT_EQ(40u, queue.size());
+}
+
+TEST(CoupledSendQueueTest, IdleStreamDoesNotAccumulateCredit)
+{
+    CoupledSendQueue queue;
+    auto a = queue.add_stream();
+    auto b = queue.add_stream();
+    for (uint64_t seq_no = 1; seq_no <= 10; seq_no++) {
+        queue.insert(make_packet(seq_no, a));
+    }
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(a, queue.pop().pkt.stream_id);
+    }
+    // b was idle meanwhile, both get the same share now.
+    for (uint64_t seq_no = 11; seq_no <= 20; seq_no++) {
+        queue.insert(make_packet(seq_no, a));
+        queue.insert(make_packet(seq_no + 100, b));
+    }
+    size_t sent[2] = {0, 0};
+    for (int i = 0; i < 10; i++) {
+        sent[queue.pop().pkt.stream_id]++;
+    }
+    EXPECT_EQ(5u, sent[a]);
+    EXPECT_EQ(5u, sent[b]);
+}
+
+TEST(CoupledSendQueueTest, RemoveStream)
+{
+    CoupledSendQueue queue;
+    auto a = queue.add_stream();
+    auto b = queue.add_stream();
+    queue.insert(make_packet(1, a));
+    queue.insert(make_packet(2, b));
+    queue.insert(make_packet(3, b));
+    queue.remove_stream(b);
+    EXPECT_EQ(1u, queue.size());
+    EXPECT_EQ(b, queue.add_stream(2));
+    EXPECT_EQ(0u, queue.stream_size(b));
+    EXPECT_EQ(1u, queue.pop().pkt.seq_no);
+    EXPECT_EQ(0u, queue.size());
+
+    queue.insert(make_packet(4, a));
+    queue.clear();
+    EXPECT_EQ(0u, queue.size());
+}
@@ -0,0 +1,162 @@
+#include <delay_gradient_estimator.h>
+#include <algorithm>
+#include <cmath>
+
+namespace bbr
+{
+namespace
+{
+// webrtc/modules/congestion_controller/goog_cc/trendline_estimator.cc
+const double kSmoothingCoef = 0.9;
+const double kThresholdGain = 4.0;
+const size_t kMaxNumDeltas = 60;
+const double kOverusingTimeThresholdMs = 10;
+// Adaptive threshold, see "Analysis and Design of the Google Congestion
+// Control for WebRTC".
+const double kThresholdUp = 0.0087;
+const double kThresholdDown = 0.039;
+const double kMaxAdaptOffsetMs = 15;
+const double kMinThreshold = 6;
+const double kMaxThreshold = 600;
+const int64_t kMaxThresholdUpdateUs = 100 * 1000;
+
+double to_ms(time::TimeDelta dt)
+{
+    return dt.value() / 1000.0;
+}
+}
+
+void DelayGradientEstimator::on_packet_acked(time::Timestamp sent_time,
+        time::Timestamp receive_time)
+{
+    if (!sent_time.is_valid() || !receive_time.is_valid()) {
+        return;
+    }
+    if (!current_group_.is_valid()) {
+        current_group_ = {sent_time, sent_time, receive_time};
+        return;
+    }
+    if (sent_time < current_group_.first_sent_time) {
+        return;
+    }
+    if (sent_time - current_group_.first_sent_time <= kBurstInterval) {
+        current_group_.last_sent_time = std::max(current_group_.last_sent_time,
+                sent_time);
+        current_group_.last_receive_time = std::max(
+                current_group_.last_receive_time, receive_time);
+        return;
+    }
+
+    // |current_group_| is complete.
+    if (prev_group_.is_valid() &&
+            current_group_.last_receive_time >= prev_group_.last_receive_time) {
+        double send_delta_ms = to_ms(current_group_.last_sent_time -
+                prev_group_.last_sent_time);
+        double arrival_delta_ms = to_ms(current_group_.last_receive_time -
+                prev_group_.last_receive_time);
+        on_group_delta(send_delta_ms, arrival_delta_ms - send_delta_ms,
+                current_group_.last_receive_time);
+    }
+    prev_group_ = current_group_;
+    current_group_ = {sent_time, sent_time, receive_time};
+}
+
+void DelayGradientEstimator::on_group_delta(double send_delta_ms,
+        double delay_delta_ms, time::Timestamp receive_time)
+{
+    num_deltas_ = std::min(num_deltas_ + 1, kMaxNumDeltas);
+    if (!first_receive_time_.is_valid()) {
+        first_receive_time_ = receive_time;
+    }
+    accumulated_delay_ms_ += delay_delta_ms;
+    smoothed_delay_ms_ = kSmoothingCoef * smoothed_delay_ms_ +
+            (1 - kSmoothingCoef) * accumulated_delay_ms_;
+
+    Point point = {to_ms(receive_time - first_receive_time_), smoothed_delay_ms_};
+    if (window_size_ < kWindowSize) {
+        window_[(window_begin_ + window_size_) % kWindowSize] = point;
+        window_size_++;
+    } else {
+        window_[window_begin_] = point;
+        window_begin_ = (window_begin_ + 1) % kWindowSize;
+    }
+    if (window_size_ == kWindowSize) {
+        slope_ = linear_fit_slope();
+    }
+    detect(send_delta_ms, receive_time);
+}
+
+double DelayGradientEstimator::linear_fit_slope() const
+{
+    double sum_x = 0;
+    double sum_y = 0;
+    for (size_t i = 0; i < window_size_; i++) {
+        sum_x += window_[i].arrival_ms;
+        sum_y += window_[i].smoothed_delay_ms;
+    }
+    double avg_x = sum_x / window_size_;
+    double avg_y = sum_y / window_size_;
+    double numerator = 0;
+    double denominator = 0;
+    for (size_t i = 0; i < window_size_; i++) {
+        double dx = window_[i].arrival_ms - avg_x;
+        numerator += dx * (window_[i].smoothed_delay_ms - avg_y);
+        denominator += dx * dx;
+    }
+    return denominator == 0 ? slope_ : numerator / denominator;
+}
+
+void DelayGradientEstimator::detect(double send_delta_ms,
+        time::Timestamp receive_time)
+{
+    if (num_deltas_ < 2) {
+        trend_ = DelayTrend::kNormal;
+        return;
+    }
+    double modified_trend = num_deltas_ * slope_ * kThresholdGain;
+    if (modified_trend > threshold_) {
+        if (overuse_time_ms_ < 0) {
+            // Assume the overuse started halfway between the two groups.
+            overuse_time_ms_ = send_delta_ms / 2;
+        } else {
+            overuse_time_ms_ += send_delta_ms;
+        }
+        overuse_count_++;
+        if (overuse_time_ms_ > kOverusingTimeThresholdMs && overuse_count_ > 1 &&
+                modified_trend >= prev_modified_trend_) {
+            overuse_time_ms_ = 0;
+            overuse_count_ = 0;
+            trend_ = DelayTrend::kOverusing;
+        }
+    } else if (modified_trend < -threshold_) {
+        overuse_time_ms_ = -1;
+        overuse_count_ = 0;
+        trend_ = DelayTrend::kUnderusing;
+    } else {
+        overuse_time_ms_ = -1;
+        overuse_count_ = 0;
+        trend_ = DelayTrend::kNormal;
+    }
+    prev_modified_trend_ = modified_trend;
+    update_threshold(modified_trend, receive_time);
+}
+
+void DelayGradientEstimator::update_threshold(double modified_trend,
+        time::Timestamp receive_time)
+{
+    if (!last_threshold_update_.is_valid()) {
+        last_threshold_update_ = receive_time;
+    }
+    // Spikes (e.g. a handover) do not teach the threshold anything.
+    if (std::fabs(modified_trend) > threshold_ + kMaxAdaptOffsetMs) {
+        last_threshold_update_ = receive_time;
+        return;
+    }
+    double k = std::fabs(modified_trend) < threshold_ ? kThresholdDown : kThresholdUp;
+    int64_t elapsed_us = std::min(
+            (receive_time - last_threshold_update_).value(), kMaxThresholdUpdateUs);
+    threshold_ += k * (std::fabs(modified_trend) - threshold_) * (elapsed_us / 1000.0);
+    threshold_ = std::min(std::max(threshold_, kMinThreshold), kMaxThreshold);
+    last_threshold_update_ = receive_time;
+}
+}
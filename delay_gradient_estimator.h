@@ -0,0 +1,87 @@
+#ifndef BBR_DELAY_GRADIENT_ESTIMATOR_H_
+#define BBR_DELAY_GRADIENT_ESTIMATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <time/timestamp.h>
+
+namespace bbr
+{
+enum class DelayTrend : uint8_t
+{
+    kNormal = 0,
+    kOverusing,  //the bottleneck queue is building up
+    kUnderusing  //the bottleneck queue is draining
+};
+
+// One-way delay gradient from the times the peer received the packets, the
+// trendline filter of WebRTC's delay based bandwidth estimation.
+// Packets sent within kBurstInterval form a group. Between consecutive
+// groups, the growth of the one-way delay is the inter-arrival minus the
+// inter-departure time: only differences of receive times are used, so the
+// offset between the two clocks cancels out. The slope of the smoothed
+// accumulated delay over the last kWindowSize groups, compared with an
+// adaptive threshold, tells a growing queue well before the min rtt or
+// losses do.
+class DelayGradientEstimator
+{
+public:
+    static constexpr time::TimeDelta kBurstInterval {5 * 1000};
+    static const size_t kWindowSize = 20;
+
+    // |receive_time| is read on the peer's clock. Packets sent before the
+    // current group (reordered) are ignored.
+    void on_packet_acked(time::Timestamp sent_time, time::Timestamp receive_time);
+
+    DelayTrend trend() const { return trend_;}
+
+    // Growth of the queueing delay, in ms per ms of arrival time.
+    double slope() const { return slope_;}
+
+    void reset() { *this = DelayGradientEstimator();}
+
+private:
+    struct PacketGroup
+    {
+        time::Timestamp first_sent_time;
+        time::Timestamp last_sent_time;
+        time::Timestamp last_receive_time;
+
+        bool is_valid() const { return first_sent_time.is_valid();}
+    };
+
+    struct Point
+    {
+        double arrival_ms;
+        double smoothed_delay_ms;
+    };
+
+    void on_group_delta(double send_delta_ms, double delay_delta_ms,
+            time::Timestamp receive_time);
+    double linear_fit_slope() const;
+    void detect(double send_delta_ms, time::Timestamp receive_time);
+    void update_threshold(double modified_trend, time::Timestamp receive_time);
+
+    PacketGroup current_group_;
+    PacketGroup prev_group_;
+
+    time::Timestamp first_receive_time_;
+    double accumulated_delay_ms_ = 0;
+    double smoothed_delay_ms_ = 0;
+    size_t num_deltas_ = 0;
+
+    std::array<Point, kWindowSize> window_ {};
+    size_t window_begin_ = 0;
+    size_t window_size_ = 0;
+    double slope_ = 0;
+
+    double threshold_ = 12.5;
+    time::Timestamp last_threshold_update_;
+    double prev_modified_trend_ = 0;
+    double overuse_time_ms_ = -1;
+    int overuse_count_ = 0;
+    DelayTrend trend_ = DelayTrend::kNormal;
+};
+}
+#endif
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <delay_gradient_estimator.h>
+
+using DelayGradientEstimator = bbr::DelayGradientEstimator;
+using DelayTrend = bbr::DelayTrend;
+using Timestamp = bbr::time::Timestamp;
+
+namespace
+{
+// One packet every 2ms for |duration_us|, the one-way delay growing by
+// |delay_growth_us| per packet on top of |base_delay_us|.
+DelayTrend feed(DelayGradientEstimator& estimator, int64_t start_us,
+        int64_t duration_us, int64_t base_delay_us, int64_t delay_growth_us)
+{
+    int64_t delay_us = base_delay_us;
+    for (int64_t sent_us = start_us; sent_us < start_us + duration_us;
+            sent_us += 2000) {
+        estimator.on_packet_acked(Timestamp(sent_us), Timestamp(sent_us + delay_us));
+        delay_us += delay_growth_us;
+    }
+    return estimator.trend();
+}
+}
+
+TEST(DelayGradientEstimatorTest, ConstantDelayIsNormal)
+{
+    DelayGradientEstimator estimator;
+    EXPECT_EQ(DelayTrend::kNormal, feed(estimator, 0, 2000 * 1000, 20000, 0));
+    EXPECT_NEAR(0.0, estimator.slope(), 1e-9);
+}
+
+TEST(DelayGradientEstimatorTest, GrowingQueueIsOverusing)
+{
+    DelayGradientEstimator estimator;
+    feed(estimator, 0, 1000 * 1000, 20000, 0);
+    // +10% one-way delay per packet: the queue grows 0.1ms per ms.
+    EXPECT_EQ(DelayTrend::kOverusing, feed(estimator, 1000 * 1000, 300 * 1000,
+                20000, 200));
+    EXPECT_GT(estimator.slope(), 0.05);
+
+    estimator.reset();
+    EXPECT_EQ(DelayTrend::kNormal, estimator.trend());
+}
+
+TEST(DelayGradientEstimatorTest, ClockOffsetCancels)
+{
+    DelayGradientEstimator near;
+    DelayGradientEstimator far;
+    feed(near, 0, 1000 * 1000, 20000, 0);
+    // The peer's clock is an hour ahead.
+    feed(far, 0, 1000 * 1000, 3600LL * 1000 * 1000, 0);
+    EXPECT_EQ(feed(near, 1000 * 1000, 300 * 1000, 20000, 200),
+            feed(far, 1000 * 1000, 300 * 1000, 3600LL * 1000 * 1000, 200));
+    EXPECT_DOUBLE_EQ(near.slope(), far.slope());
+}
@@ -1,5 +1,4 @@
 #include <loss_detect.h>
-#include <packet_history.h>
 
 namespace bbr
 {
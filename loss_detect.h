@@ -5,17 +5,11 @@
 #include <cstdint>
 #include <vector>
 #include <bbr.h>
-#include <deque>
 #include <time/timestamp.h>
+#include <sent_packet_table.h>
 
 namespace bbr
 {
-template <typename PacketType,
-    template<typename Elem,
-        typename Allocator = std::allocator<Elem>>
-            class ContainerType = std::deque>
-class PacketHistory;
-
 class LossDetect
 {
     const uint64_t kDefaultThreshold = 2;
@@ -29,8 +23,18 @@ public:
     void set_reordering_threshold(uint64_t threshold);
     void set_reordering_timeout(time::TimeDelta timeout);
 
+    // Back to the default thresholds, the packet table is kept.
+    void reset() {
+        reordering_threshold_ = kDefaultThreshold;
+    }
+
+    // Sizes and send times of the sent packets, owned by the sender.
+    void set_sent_packets(const SentPacketTable* sent_pkts) {
+        sent_pkts_ = sent_pkts;
+    }
+
 private:
-    PacketHistory<SendingPacket> pkts_history_;
+    const SentPacketTable* sent_pkts_ = nullptr;
 
     size_t reordering_threshold_ = kDefaultThreshold;
 };
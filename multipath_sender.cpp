@@ -0,0 +1,6 @@
+#include <multipath_sender.h>
+
+namespace bbr
+{
+template class BasicMultipathSender<>;
+}
@@ -0,0 +1,322 @@
+#ifndef BBR_MULTIPATH_SENDER_H_
+#define BBR_MULTIPATH_SENDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <bbr_sender.h>
+#include <path_scheduler.h>
+
+namespace bbr
+{
+// Sends one connection over several paths at once, e.g. Wi-Fi and cellular.
+// Every path has its own BbrAlgorithm, packet table and loss detection, as
+// if it were a BbrSender. Each packet goes to the path which delivers it
+// the earliest, see estimated_delivery(); a packet lost on one path is
+// reinjected on the path delivering it the earliest among the others, or
+// on the first path whose cwnd opens if they are all full.
+//
+// Every path numbers its packets: the seq_no of a sent packet is replaced
+// by the packet number of its path, which the acks of that path carry. The
+// payload identifies the data, e.g. with stream frames.
+// Policies as in BasicBbrSender.
+template <typename Clock = time::SystemClock,
+         typename LossDetector = LossDetect,
+         typename Observer = NullBbrObserver>
+class BasicMultipathSender
+{
+public:
+    using PathId = uint32_t;
+
+    // |params| applies to every path.
+    explicit BasicMultipathSender(const Bbrparams& params = profiles::kDefault,
+            Clock clock = Clock(),
+            Observer observer = Observer());
+
+    // A new path sending through |sender|, probing its bandwidth in STARTUP.
+    PathId add_path(PacketSender* sender);
+
+    size_t path_count() const { return paths_.size();}
+
+    // return false if bbr determines to buffered this pkt: the cwnd of every
+    // path is full.
+    bool send_or_queued_pkt(SendingPacket&& pkt);
+
+    // acks of the packets sent on |path|, see on_pkt_ack() of BasicBbrSender.
+    void on_pkt_ack(PathId path, const AckedPacket& pkt);
+
+    void on_pkts_ack(PathId path, const std::vector<AckedTrunk>& trunks);
+
+    //sum of the pacing rates of the paths
+    common::BandWidth bandwidth() const;
+
+    const BbrAlgorithm& path_bbr(PathId path) const { return paths_.at(path)->bbr;}
+    size_t bytes_inflight(PathId path) const {
+        return paths_.at(path)->bytes_inflight;
+    }
+    //packets waiting for a cwnd, lost ones included
+    size_t buffered() const { return pkts_buffer_.size() + reinjections_.size();}
+    uint64_t total_pkts_reinjected() const { return total_pkts_reinjected_;}
+
+    Clock& clock() { return clock_;}
+    Observer& observer() { return observer_;}
+
+private:
+    struct Path
+    {
+        Path(PacketSender* sender, const Bbrparams& params, time::Timestamp now)
+            :bbr(params, default_params::kInitCwnd, default_params::kInitRtt, now),
+             socket(sender)
+        {
+            bbr.set_sent_packets(&sent_pkts);
+            loss_detect.set_sent_packets(&sent_pkts);
+        }
+
+        //payloads are kept for reinjection
+        SentPacketTable sent_pkts{true};
+        BbrAlgorithm bbr;
+        LossDetector loss_detect;
+        PacketSender* socket;
+        size_t bytes_inflight = 0;
+        uint64_t next_pkt_no = 1;
+    };
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // The path to send |bytes| on, npos if every cwnd (but |exclude|) is full.
+    size_t select_path(size_t bytes, size_t exclude = npos);
+
+    bool send_pkt(size_t path_index, SendingPacket&& pkt);
+
+    void on_congestion_event(size_t path_index, size_t prior_bytes_inflight,
+            time::Timestamp now, const std::vector<uint64_t>& lost_nos,
+            std::vector<internal::AckedPacket>& acked_pkts, size_t ecn_ce_count);
+
+    void reinject(size_t lost_path_index, SendingPacket&& pkt);
+
+    void check_after_acked();
+
+    const Bbrparams params_;
+    Clock clock_;
+    Observer observer_;
+
+    //the address of a path is referenced by its own components
+    std::vector<std::unique_ptr<Path>> paths_;
+    std::vector<PathEstimate> estimates_;
+
+    std::deque<SendingPacket> pkts_buffer_;
+    //lost packets no other path could take yet, sent before pkts_buffer_
+    std::deque<SendingPacket> reinjections_;
+
+    uint64_t total_pkts_reinjected_ = 0;
+};
+
+using MultipathSender = BasicMultipathSender<>;
+
+template <typename Clock, typename LossDetector, typename Observer>
+BasicMultipathSender<Clock, LossDetector, Observer>::BasicMultipathSender(
+        const Bbrparams& params, Clock clock, Observer observer)
+    :params_(params),
+     clock_(std::move(clock)),
+     observer_(std::move(observer))
+{}
+
+template <typename Clock, typename LossDetector, typename Observer>
+typename BasicMultipathSender<Clock, LossDetector, Observer>::PathId
+BasicMultipathSender<Clock, LossDetector, Observer>::add_path(PacketSender* sender)
+{
+    assert(sender != nullptr);
+    paths_.emplace_back(new Path(sender, params_, clock_.now()));
+    estimates_.resize(paths_.size());
+    return static_cast<PathId>(paths_.size() - 1);
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+bool BasicMultipathSender<Clock, LossDetector, Observer>::send_or_queued_pkt(
+        SendingPacket&& pkt)
+{
+    size_t path_index = select_path(pkt.size);
+    if(path_index == npos) {
+        pkts_buffer_.push_back(std::move(pkt));
+        return false;
+    }
+    return send_pkt(path_index, std::move(pkt));
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+common::BandWidth BasicMultipathSender<Clock, LossDetector, Observer>::bandwidth() const
+{
+    common::BandWidth total(0);
+    for(const auto& path : paths_) {
+        total = common::BandWidth(total.value() + path->bbr.pacing_rate().value());
+    }
+    return total;
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+size_t BasicMultipathSender<Clock, LossDetector, Observer>::select_path(
+        size_t bytes, size_t exclude)
+{
+    for(size_t i = 0; i < paths_.size(); i++) {
+        const Path& path = *paths_[i];
+        const BbrModel& model = path.bbr.model();
+        PathEstimate& estimate = estimates_[i];
+        //no sample yet in STARTUP, the pacing rate comes from the initial cwnd
+        estimate.bw = model.estimated_bw() > common::BandWidth(0) ?
+                model.estimated_bw() : path.bbr.pacing_rate();
+        estimate.min_rtt = model.min_rtt();
+        estimate.bytes_inflight = path.bytes_inflight;
+        estimate.can_send = path.bbr.can_send(path.bytes_inflight);
+    }
+    return earliest_delivery_path(estimates_, bytes, exclude);
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+bool BasicMultipathSender<Clock, LossDetector, Observer>::send_pkt(
+        size_t path_index, SendingPacket&& pkt)
+{
+    Path& path = *paths_[path_index];
+    auto now = clock_.now();
+    pkt.seq_no = path.next_pkt_no++;
+    size_t slot = path.sent_pkts.insert(pkt.seq_no, pkt.size, now);
+    path.sent_pkts.payload(slot) = pkt;
+    path.bbr.on_packet_sent(pkt.seq_no, pkt.size, path.bytes_inflight,
+            true, now, observer_);
+    path.bytes_inflight += pkt.size;
+
+    return path.socket->send_pkt(std::move(pkt));
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+void BasicMultipathSender<Clock, LossDetector, Observer>::on_pkt_ack(
+        PathId path_id, const AckedPacket& pkt)
+{
+    Path& path = *paths_.at(path_id);
+    auto now = clock_.now();
+    size_t prior_bytes_inflight = path.bytes_inflight;
+    auto lost_nos = path.loss_detect.on_pkt_ack(pkt);
+
+    std::vector<internal::AckedPacket> acked_pkts;
+    size_t acked = path.sent_pkts.find(pkt.seq_no);
+    if(acked != SentPacketTable::npos) {
+        acked_pkts.push_back({pkt.seq_no, path.sent_pkts.bytes(acked),
+                pkt.arrival_time});
+    }
+    on_congestion_event(path_id, prior_bytes_inflight, now, lost_nos, acked_pkts,
+            pkt.ecn_ce ? 1 : 0);
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+void BasicMultipathSender<Clock, LossDetector, Observer>::on_pkts_ack(
+        PathId path_id, const std::vector<AckedTrunk>& trunks)
+{
+    Path& path = *paths_.at(path_id);
+    auto now = clock_.now();
+    size_t prior_bytes_inflight = path.bytes_inflight;
+    auto lost_nos = path.loss_detect.on_pkts_ack(trunks);
+
+    size_t ecn_ce_count = 0;
+    std::vector<internal::AckedPacket> acked_pkts;
+    for(const auto& trunk : trunks) {
+        assert(trunk.seq_no_end >= trunk.seq_no_begin);
+        ecn_ce_count += trunk.ecn_ce_count;
+        assert(trunk.arrival_times.size() ==
+                trunk.seq_no_end-trunk.seq_no_begin+1);
+        for(uint64_t seq_no = trunk.seq_no_begin;
+                seq_no <= trunk.seq_no_end; seq_no ++)
+        {
+            size_t acked = path.sent_pkts.find(seq_no);
+            //if we received fake ack-frame, ignore it
+            if(acked == SentPacketTable::npos) {
+                continue;
+            }
+            acked_pkts.push_back({seq_no, path.sent_pkts.bytes(acked),
+                trunk.arrival_times[seq_no-trunk.seq_no_begin]});
+        }
+    }
+    on_congestion_event(path_id, prior_bytes_inflight, now, lost_nos, acked_pkts,
+            ecn_ce_count);
+}
+
+//the lost packets are reinjected once the path has consumed their states
+template <typename Clock, typename LossDetector, typename Observer>
+void BasicMultipathSender<Clock, LossDetector, Observer>::on_congestion_event(
+        size_t path_index, size_t prior_bytes_inflight, time::Timestamp now,
+        const std::vector<uint64_t>& lost_nos,
+        std::vector<internal::AckedPacket>& acked_pkts, size_t ecn_ce_count)
+{
+    Path& path = *paths_[path_index];
+
+    std::vector<internal::LostPacket> lost_pkts;
+    std::vector<SendingPacket> lost_payloads;
+    for(auto lost_no : lost_nos) {
+        size_t lost = path.sent_pkts.find(lost_no);
+        assert(lost != SentPacketTable::npos);
+        lost_pkts.push_back({lost_no, path.sent_pkts.bytes(lost)});
+        lost_payloads.push_back(std::move(path.sent_pkts.payload(lost)));
+        assert(path.bytes_inflight >= path.sent_pkts.bytes(lost));
+        path.bytes_inflight -= path.sent_pkts.bytes(lost);
+    }
+    for(const auto& pkt : acked_pkts) {
+        assert(path.bytes_inflight >= pkt.bytes);
+        path.bytes_inflight -= pkt.bytes;
+    }
+
+    path.bbr.on_congestion_event(prior_bytes_inflight, now, acked_pkts,
+            lost_pkts, observer_, ecn_ce_count);
+    for(const auto& pkt : acked_pkts) {
+        path.sent_pkts.erase(pkt.seq_no);
+    }
+    for(const auto& pkt : lost_pkts) {
+        path.sent_pkts.erase(pkt.seq_no);
+    }
+
+    for(auto& pkt : lost_payloads) {
+        reinject(path_index, std::move(pkt));
+    }
+    check_after_acked();
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+void BasicMultipathSender<Clock, LossDetector, Observer>::reinject(
+        size_t lost_path_index, SendingPacket&& pkt)
+{
+    total_pkts_reinjected_++;
+    size_t path_index = select_path(pkt.size, lost_path_index);
+    if(path_index == npos) {
+        reinjections_.push_back(std::move(pkt));
+        return;
+    }
+    send_pkt(path_index, std::move(pkt));
+}
+
+template <typename Clock, typename LossDetector, typename Observer>
+void BasicMultipathSender<Clock, LossDetector, Observer>::check_after_acked()
+{
+    // 1) lost packets first, on any path now
+    while(!reinjections_.empty()) {
+        size_t path_index = select_path(reinjections_.front().size);
+        if(path_index == npos) {
+            return;
+        }
+        send_pkt(path_index, std::move(reinjections_.front()));
+        reinjections_.pop_front();
+    }
+    // 2) buffered pkts
+    while(!pkts_buffer_.empty()) {
+        size_t path_index = select_path(pkts_buffer_.front().size);
+        if(path_index == npos) {
+            return;
+        }
+        send_pkt(path_index, std::move(pkts_buffer_.front()));
+        pkts_buffer_.pop_front();
+    }
+}
+
+// The default sender is compiled once, in multipath_sender.cpp.
+extern template class BasicMultipathSender<>;
+}
+#endif
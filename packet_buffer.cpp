@@ -0,0 +1,80 @@
+#include <packet_buffer.h>
+#include <cassert>
+#include <algorithm>
+
+namespace bbr
+{
+namespace
+{
+bool seq_no_less(const PacketBuffer::Packet& pkt, uint64_t seq_no)
+{
+    return pkt.pkt.seq_no < seq_no;
+}
+}
+
+void PacketBuffer::insert(Packet&& pkt)
+{
+    pkt.valid = true;
+    // Packets are mostly buffered in sending order.
+    if (size() == 0 || pkts_.back().pkt.seq_no < pkt.pkt.seq_no) {
+        pkts_.push_back(std::move(pkt));
+        return;
+    }
+    auto it = std::lower_bound(pkts_.begin() + head_, pkts_.end(),
+            pkt.pkt.seq_no, seq_no_less);
+    if (it != pkts_.end() && it->pkt.seq_no == pkt.pkt.seq_no) {
+        return;
+    }
+    pkts_.insert(it, std::move(pkt));
+}
+
+PacketBuffer::Packet PacketBuffer::get(uint64_t seq_no)
+{
+    auto it = std::lower_bound(pkts_.begin() + head_, pkts_.end(), seq_no,
+            seq_no_less);
+    if (it == pkts_.end() || it->pkt.seq_no != seq_no) {
+        return Packet();
+    }
+    return *it;
+}
+
+PacketBuffer::Packet PacketBuffer::pop()
+{
+    assert(size() > 0);
+    Packet pkt = std::move(pkts_[head_]);
+    head_++;
+    if (head_ == pkts_.size()) {
+        pkts_.clear();
+        head_ = 0;
+    } else if (head_ * 2 >= pkts_.size()) {
+        pkts_.erase(pkts_.begin(), pkts_.begin() + head_);
+        head_ = 0;
+    }
+    return pkt;
+}
+
+PacketBuffer::Packet& PacketBuffer::front()
+{
+    assert(size() > 0);
+    return pkts_[head_];
+}
+
+size_t PacketBuffer::size() const
+{
+    return pkts_.size() - head_;
+}
+
+void PacketBuffer::clear()
+{
+    pkts_.clear();
+    head_ = 0;
+}
+
+void PacketBuffer::release_memory()
+{
+    if (size() == 0) {
+        std::vector<Packet>().swap(pkts_);
+        head_ = 0;
+    }
+}
+}
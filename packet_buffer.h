@@ -9,6 +9,7 @@
 namespace bbr
 {
 
+// Packets waiting for cwnd, ordered by seq_no.
 class PacketBuffer
 {
 public:
@@ -26,6 +27,16 @@ public:
     Packet& front();
 
     size_t size() const;
+
+    // Drops all packets, keeps the allocated memory.
+    void clear();
+
+    // Frees the allocated memory of an empty buffer.
+    void release_memory();
+private:
+    // Popped packets before |head_| are dropped once they are the majority.
+    std::vector<Packet> pkts_;
+    size_t head_ = 0;
 };
 }
 #endif
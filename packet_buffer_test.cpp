@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <packet_buffer.h>
+
+using PacketBuffer = bbr::PacketBuffer;
+
+namespace
+{
+PacketBuffer::Packet make_packet(uint64_t seq_no)
+{
+    PacketBuffer::Packet pkt;
+    pkt.pkt.seq_no = seq_no;
+    pkt.pkt.size = 1000 + seq_no;
+    return pkt;
+}
+}
+
+TEST(PacketBufferTest, PopsInSeqNoOrder)
+{
+    PacketBuffer buffer;
+    for (uint64_t seq_no : {3, 1, 4, 2, 5, 4}) {
+        buffer.insert(make_packet(seq_no));
+    }
+    // Inserting a buffered seq_no again does nothing.
+    EXPECT_EQ(5u, buffer.size());
+
+    EXPECT_TRUE(buffer.get(4).valid);
+    EXPECT_EQ(1004u, buffer.get(4).pkt.size);
+    EXPECT_FALSE(buffer.get(6).valid);
+
+    for (uint64_t seq_no = 1; seq_no <= 5; seq_no++) {
+        EXPECT_EQ(seq_no, buffer.front().pkt.seq_no);
+        PacketBuffer::Packet pkt = buffer.pop();
+        EXPECT_TRUE(pkt.valid);
+        EXPECT_EQ(seq_no, pkt.pkt.seq_no);
+        EXPECT_FALSE(buffer.get(seq_no).valid);
+    }
+    EXPECT_EQ(0u, buffer.size());
+}
+
+TEST(PacketBufferTest, InterleavedInsertAndPop)
+{
+    PacketBuffer buffer;
+    uint64_t next_pop = 1;
+    for (uint64_t seq_no = 1; seq_no <= 100; seq_no++) {
+        buffer.insert(make_packet(seq_no));
+        if (seq_no % 3 == 0) {
+            EXPECT_EQ(next_pop++, buffer.pop().pkt.seq_no);
+            EXPECT_EQ(next_pop++, buffer.pop().pkt.seq_no);
+        }
+    }
+    EXPECT_EQ(100 - next_pop + 1, buffer.size());
+    EXPECT_TRUE(buffer.get(100).valid);
+    EXPECT_FALSE(buffer.get(next_pop - 1).valid);
+
+    buffer.clear();
+    EXPECT_EQ(0u, buffer.size());
+    EXPECT_FALSE(buffer.get(100).valid);
+    buffer.release_memory();
+
+    buffer.insert(make_packet(7));
+    EXPECT_EQ(7u, buffer.pop().pkt.seq_no);
+}
@@ -0,0 +1,198 @@
+#include <path_cache.h>
+#include <cstring>
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif //__unix__
+
+namespace bbr
+{
+namespace
+{
+size_t round_up_to_power_of_two(size_t capacity)
+{
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+    return rounded;
+}
+
+// splitmix64 finalizer, keys are often addresses with few random bits.
+uint64_t mix(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebull;
+    key ^= key >> 31;
+    return key;
+}
+
+#ifdef __unix__
+// Precedes the entries in the file.
+struct alignas(64) FileHeader
+{
+    static constexpr uint64_t kMagic = 0x4242525041544843ull; //"BBRPATHC"
+    // 2: updated_at is wall clock instead of time since powerup.
+    static constexpr uint32_t kVersion = 2;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t capacity;
+};
+#endif //__unix__
+}
+
+PathCache::PathCache(size_t capacity)
+    :mask_(round_up_to_power_of_two(capacity) - 1),
+     own_entries_(new Entry[mask_ + 1]())
+{
+    entries_ = own_entries_.get();
+}
+
+PathCache::PathCache(Entry* entries, size_t capacity, void* mapping,
+        size_t mapping_size)
+    :entries_(entries),
+     mask_(capacity - 1),
+     mapping_(mapping),
+     mapping_size_(mapping_size)
+{
+    recover();
+}
+
+PathCache::~PathCache()
+{
+#ifdef __unix__
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif //__unix__
+}
+
+std::unique_ptr<PathCache> PathCache::open_file(const std::string& path,
+        size_t capacity)
+{
+#ifdef __unix__
+    capacity = round_up_to_power_of_two(capacity);
+    const size_t size = sizeof(FileHeader) + capacity * sizeof(Entry);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    bool compatible = false;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size) {
+        FileHeader header;
+        compatible = pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                header.magic == FileHeader::kMagic &&
+                header.version == FileHeader::kVersion &&
+                header.entry_size == sizeof(Entry) &&
+                header.capacity == capacity;
+    }
+    if (!compatible) {
+        // Truncating to 0 first zeroes all entries.
+        FileHeader header = {FileHeader::kMagic, FileHeader::kVersion,
+                static_cast<uint32_t>(sizeof(Entry)), capacity};
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0 ||
+                pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            ::close(fd);
+            return nullptr;
+        }
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    Entry* entries = reinterpret_cast<Entry*>(
+            static_cast<char*>(mapping) + sizeof(FileHeader));
+    return std::unique_ptr<PathCache>(
+            new PathCache(entries, capacity, mapping, size));
+#else
+    (void)path;
+    (void)capacity;
+    return nullptr;
+#endif //__unix__
+}
+
+bool PathCache::lookup(uint64_t key, time::Timestamp now,
+        time::TimeDelta max_age, PathInfo& info) const
+{
+    if (key == 0) {
+        return false;
+    }
+    const Entry& e = entry(key);
+    uint64_t words[kWords];
+    for (int retry = 0; retry < kMaxReadRetries; retry++) {
+        uint32_t seq0 = e.seq.load(std::memory_order_acquire);
+        if (seq0 & 1) {
+            continue;
+        }
+        for (size_t i = 0; i < kWords; i++) {
+            words[i] = e.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.seq.load(std::memory_order_relaxed) != seq0) {
+            continue;
+        }
+
+        PathInfo cached;
+        std::memcpy(&cached, words, sizeof(PathInfo));
+        // A timestamp in the future means the wall clock was set back.
+        if (cached.key != key || !cached.updated_at.is_valid() ||
+                now < cached.updated_at || now - cached.updated_at > max_age) {
+            return false;
+        }
+        info = cached;
+        return true;
+    }
+    return false;
+}
+
+bool PathCache::update(const PathInfo& info)
+{
+    if (info.key == 0) {
+        return false;
+    }
+    Entry& e = entry(info.key);
+    uint32_t seq = e.seq.load(std::memory_order_relaxed);
+    if ((seq & 1) || !e.seq.compare_exchange_strong(seq, seq + 1,
+                std::memory_order_relaxed)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t words[kWords] = {0};
+    std::memcpy(words, &info, sizeof(PathInfo));
+    for (size_t i = 0; i < kWords; i++) {
+        e.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    e.seq.store(seq + 2, std::memory_order_release);
+    return true;
+}
+
+PathCache::Entry& PathCache::entry(uint64_t key) const
+{
+    return entries_[mix(key) & mask_];
+}
+
+void PathCache::recover()
+{
+    for (size_t i = 0; i <= mask_; i++) {
+        Entry& e = entries_[i];
+        uint32_t seq = e.seq.load(std::memory_order_relaxed);
+        if (seq & 1) {
+            for (size_t w = 0; w < kWords; w++) {
+                e.words[w].store(0, std::memory_order_relaxed);
+            }
+            e.seq.store(seq + 1, std::memory_order_release);
+        }
+    }
+}
+}
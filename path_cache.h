@@ -0,0 +1,105 @@
+#ifndef BBR_PATH_CACHE_H_
+#define BBR_PATH_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <common/rate.h>
+#include <time/timestamp.h>
+
+namespace bbr
+{
+// What a connection learned about the path to its destination, used to
+// warm start the next connection to the same destination, see
+// BbrAlgorithm::warm_start().
+struct PathInfo
+{
+    // Identifies the destination, e.g. a hash of its address. 0 is reserved
+    // for empty entries.
+    uint64_t key = 0;
+    common::BandWidth max_bw {0};
+    time::TimeDelta min_rtt;
+    // BbrModel::kDefaultInflightBytes if no loss bounded it.
+    size_t inflight_hi = 0;
+    // Wall clock (see PathCache::now()), the entry may outlive the process
+    // and the machine's uptime.
+    time::Timestamp updated_at;
+
+    bool is_valid() const {
+        return key != 0 && max_bw > common::BandWidth(0) && min_rtt.is_valid();
+    }
+};
+
+// Fixed size, direct mapped cache of PathInfo shared by all connections
+// (and threads) of a process. Neither readers nor writers ever block:
+// every entry is a seqlock (see common/seqlock.h), a writer finding an entry
+// being written by another thread drops its update, a reader racing with a
+// writer retries a few times and then misses.
+// Destinations whose keys map to the same entry evict each other.
+//
+// The entries can live in a memory mapped file so that they survive process
+// restarts, see open_file().
+class PathCache
+{
+    static const size_t kWords = (sizeof(PathInfo) + sizeof(uint64_t) - 1)
+            / sizeof(uint64_t);
+    static const int kMaxReadRetries = 16;
+
+    // All-zero is a valid empty entry, which is what a new file holds.
+    struct alignas(64) Entry
+    {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint64_t> words[kWords];
+    };
+    static_assert(std::is_trivially_copyable<PathInfo>::value,
+            "PathInfo is copied word by word");
+public:
+    // |capacity| is rounded up to a power of two.
+    explicit PathCache(size_t capacity = 4096);
+    ~PathCache();
+
+    PathCache(const PathCache&) = delete;
+    PathCache& operator=(const PathCache&) = delete;
+
+    // Maps |path| (created if missing) and keeps the entries there.
+    // The content is dropped if it was written with another capacity or
+    // layout. nullptr on error, or if memory mapped files are not supported.
+    static std::unique_ptr<PathCache> open_file(const std::string& path,
+            size_t capacity = 4096);
+
+    // The clock of PathInfo::updated_at and of lookup(), time since epoch.
+    static time::Timestamp now() {
+        return time::Timestamp::now(time::Timestamp::kSinceEpoch);
+    }
+
+    // false if |key| is not cached, older than |max_age| or the entry is busy.
+    bool lookup(uint64_t key, time::Timestamp now, time::TimeDelta max_age,
+            PathInfo& info) const;
+
+    // false if the entry is being written by another thread.
+    bool update(const PathInfo& info);
+
+    size_t capacity() const { return mask_ + 1;}
+
+private:
+    PathCache(Entry* entries, size_t capacity, void* mapping, size_t mapping_size);
+
+    Entry& entry(uint64_t key) const;
+
+    // Entries left half written by a process that died in the middle of an
+    // update are emptied.
+    void recover();
+
+private:
+    Entry* entries_;
+    size_t mask_;
+    std::unique_ptr<Entry[]> own_entries_;
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+};
+}
+#endif
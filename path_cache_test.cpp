@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <thread>
+#include <atomic>
+#include <path_cache.h>
+
+using PathCache = bbr::PathCache;
+using PathInfo = bbr::PathInfo;
+using BandWidth = bbr::common::BandWidth;
+using Timestamp = bbr::time::Timestamp;
+using TimeDelta = bbr::time::TimeDelta;
+
+namespace
+{
+PathInfo make_path(uint64_t key, int64_t bw_bps, Timestamp at)
+{
+    PathInfo path;
+    path.key = key;
+    path.max_bw = BandWidth(bw_bps);
+    path.min_rtt = TimeDelta(20 * 1000);
+    path.inflight_hi = 64 * 1024;
+    path.updated_at = at;
+    return path;
+}
+const TimeDelta kMaxAge(60 * 1000 * 1000);
+}
+
+TEST(PathCacheTest, UpdateLookup)
+{
+    PathCache cache(100);
+    EXPECT_EQ(128u, cache.capacity());
+
+    PathInfo path;
+    EXPECT_FALSE(cache.lookup(1, Timestamp(0), kMaxAge, path));
+    EXPECT_FALSE(cache.update(make_path(0, 1000, Timestamp(0))));
+
+    EXPECT_TRUE(cache.update(make_path(1, 1000 * 1000, Timestamp(1000))));
+    ASSERT_TRUE(cache.lookup(1, Timestamp(2000), kMaxAge, path));
+    EXPECT_EQ(BandWidth(1000 * 1000), path.max_bw);
+    EXPECT_EQ(TimeDelta(20 * 1000), path.min_rtt);
+    EXPECT_EQ(64 * 1024u, path.inflight_hi);
+    EXPECT_FALSE(cache.lookup(2, Timestamp(2000), kMaxAge, path));
+
+    // Too old, or from the future.
+    EXPECT_TRUE(cache.lookup(1, Timestamp(1000 + kMaxAge.value()), kMaxAge, path));
+    EXPECT_FALSE(cache.lookup(1, Timestamp(1001 + kMaxAge.value()), kMaxAge, path));
+    EXPECT_FALSE(cache.lookup(1, Timestamp(999), kMaxAge, path));
+
+    EXPECT_TRUE(cache.update(make_path(1, 2000 * 1000, Timestamp(3000))));
+    ASSERT_TRUE(cache.lookup(1, Timestamp(3000), kMaxAge, path));
+    EXPECT_EQ(BandWidth(2000 * 1000), path.max_bw);
+}
+
+TEST(PathCacheTest, CollidingKeysEvict)
+{
+    PathCache cache(1);
+    PathInfo path;
+    EXPECT_TRUE(cache.update(make_path(1, 1000, Timestamp(0))));
+    EXPECT_TRUE(cache.update(make_path(2, 2000, Timestamp(0))));
+    EXPECT_FALSE(cache.lookup(1, Timestamp(0), kMaxAge, path));
+    ASSERT_TRUE(cache.lookup(2, Timestamp(0), kMaxAge, path));
+    EXPECT_EQ(BandWidth(2000), path.max_bw);
+}
+
+TEST(PathCacheTest, ConcurrentReadersSeeWholeEntries)
+{
+    PathCache cache(16);
+    PathInfo first = make_path(7, 0, Timestamp(0));
+    first.inflight_hi = 0;
+    cache.update(first);
+    std::atomic<bool> stop{false};
+    std::thread writer([&]() {
+        for (int64_t i = 1; !stop.load(); i++) {
+            // bw and inflight_hi always agree.
+            PathInfo path = make_path(7, i, Timestamp(0));
+            path.inflight_hi = static_cast<size_t>(i);
+            cache.update(path);
+        }
+    });
+    // A lookup may miss while the entry is being written, but never returns
+    // a torn entry.
+    for (int i = 0; i < 100000; i++) {
+        PathInfo path;
+        if (cache.lookup(7, Timestamp(0), kMaxAge, path) &&
+                path.max_bw.value() != static_cast<int64_t>(path.inflight_hi)) {
+            ADD_FAILURE() << "torn entry, bw:" << path.max_bw.value()
+                    << " inflight_hi:" << path.inflight_hi;
+            break;
+        }
+    }
+    stop = true;
+    writer.join();
+}
+
+TEST(PathCacheTest, FileSurvivesRestart)
+{
+    char path_name[] = "/tmp/bbr_path_cache_XXXXXX";
+    int fd = mkstemp(path_name);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    PathInfo path;
+    {
+        auto cache = PathCache::open_file(path_name, 64);
+        ASSERT_TRUE(cache != nullptr);
+        EXPECT_FALSE(cache->lookup(3, Timestamp(0), kMaxAge, path));
+        EXPECT_TRUE(cache->update(make_path(3, 3000, Timestamp(0))));
+    }
+    {
+        auto cache = PathCache::open_file(path_name, 64);
+        ASSERT_TRUE(cache != nullptr);
+        ASSERT_TRUE(cache->lookup(3, Timestamp(0), kMaxAge, path));
+        EXPECT_EQ(BandWidth(3000), path.max_bw);
+    }
+    {
+        // Another capacity starts over.
+        auto cache = PathCache::open_file(path_name, 128);
+        ASSERT_TRUE(cache != nullptr);
+        EXPECT_FALSE(cache->lookup(3, Timestamp(0), kMaxAge, path));
+    }
+    std::remove(path_name);
+}
+
+TEST(PathCacheTest, AgesByWallClockAcrossBoots)
+{
+    char path_name[] = "/tmp/bbr_path_cache_XXXXXX";
+    int fd = mkstemp(path_name);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    const Timestamp now = PathCache::now();
+    PathInfo path;
+    {
+        auto cache = PathCache::open_file(path_name, 64);
+        ASSERT_TRUE(cache != nullptr);
+        EXPECT_TRUE(cache->update(make_path(1, 1000, now - TimeDelta(1000))));
+        // Stamped with the uptime of a past boot.
+        EXPECT_TRUE(cache->update(make_path(2, 2000, Timestamp::now())));
+        // Written before the wall clock was set back.
+        Timestamp future = now;
+        future += kMaxAge;
+        EXPECT_TRUE(cache->update(make_path(3, 3000, future)));
+    }
+    auto cache = PathCache::open_file(path_name, 64);
+    ASSERT_TRUE(cache != nullptr);
+    ASSERT_TRUE(cache->lookup(1, PathCache::now(), kMaxAge, path));
+    EXPECT_EQ(BandWidth(1000), path.max_bw);
+    EXPECT_FALSE(cache->lookup(2, PathCache::now(), kMaxAge, path));
+    EXPECT_FALSE(cache->lookup(3, PathCache::now(), kMaxAge, path));
+    std::remove(path_name);
+}
@@ -0,0 +1,59 @@
+#ifndef BBR_PATH_SCHEDULER_H_
+#define BBR_PATH_SCHEDULER_H_
+
+#include <cstddef>
+#include <vector>
+#include <common/rate.h>
+#include <time/interval.h>
+
+namespace bbr
+{
+// What the scheduler of BasicMultipathSender knows of one path, taken from
+// the BbrModel of the path.
+struct PathEstimate
+{
+    common::BandWidth bw {0};
+    time::TimeDelta min_rtt;
+    size_t bytes_inflight = 0;
+    // cwnd not full.
+    bool can_send = false;
+};
+
+// Time until |bytes| sent now on |path| reach the peer: half the min rtt,
+// the queue built by what is in flight beyond one BDP, and the
+// transmission time of |bytes|. Infinite without a bandwidth estimate.
+inline time::TimeDelta estimated_delivery(const PathEstimate& path, size_t bytes)
+{
+    if (path.bw <= common::BandWidth(0) || !path.bw.is_valid() ||
+            !path.min_rtt.is_valid()) {
+        return time::TimeDelta::positive_infinity();
+    }
+    using time::operator/;
+    time::TimeDelta drain = path.bytes_inflight / path.bw;
+    time::TimeDelta queue = drain > path.min_rtt ? drain - path.min_rtt
+            : time::TimeDelta(0);
+    return path.min_rtt / 2 + queue + bytes / path.bw;
+}
+
+// The path which can send with the earliest estimated delivery of |bytes|,
+// skipping |exclude|. Ties go to the lower index, npos if no path can send.
+inline size_t earliest_delivery_path(const std::vector<PathEstimate>& paths,
+        size_t bytes, size_t exclude = static_cast<size_t>(-1))
+{
+    const size_t npos = static_cast<size_t>(-1);
+    size_t best = npos;
+    time::TimeDelta best_delivery = time::TimeDelta::positive_infinity();
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (i == exclude || !paths[i].can_send) {
+            continue;
+        }
+        time::TimeDelta delivery = estimated_delivery(paths[i], bytes);
+        if (best == npos || delivery < best_delivery) {
+            best = i;
+            best_delivery = delivery;
+        }
+    }
+    return best;
+}
+}
+#endif
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <path_scheduler.h>
+
+using PathEstimate = bbr::PathEstimate;
+using BandWidth = bbr::common::BandWidth;
+using TimeDelta = bbr::time::TimeDelta;
+using namespace bbr::time;
+
+namespace
+{
+PathEstimate make_path(int64_t bw_bps, TimeDelta min_rtt, size_t inflight)
+{
+    PathEstimate path;
+    path.bw = BandWidth(bw_bps);
+    path.min_rtt = min_rtt;
+    path.bytes_inflight = inflight;
+    path.can_send = true;
+    return path;
+}
+}
+
+TEST(PathSchedulerTest, EstimatedDelivery)
+{
+    // 8 Mbps: 1000 bytes take 1ms.
+    PathEstimate path = make_path(8000000, 20_ms, 0);
+    EXPECT_EQ(11_ms, bbr::estimated_delivery(path, 1000));
+
+    // One BDP in flight does not queue.
+    path.bytes_inflight = 20000;
+    EXPECT_EQ(11_ms, bbr::estimated_delivery(path, 1000));
+
+    // Two BDPs queue one min rtt.
+    path.bytes_inflight = 40000;
+    EXPECT_EQ(31_ms, bbr::estimated_delivery(path, 1000));
+
+    path.bw = BandWidth(0);
+    EXPECT_FALSE(bbr::estimated_delivery(path, 1000).is_valid());
+}
+
+TEST(PathSchedulerTest, EarliestDeliveryOfTwoLinks)
+{
+    // Wi-Fi: 40 Mbps, 20ms. Cellular: 8 Mbps, 60ms.
+    std::vector<PathEstimate> paths = {
+        make_path(40000000, 20_ms, 0),
+        make_path(8000000, 60_ms, 0)};
+    EXPECT_EQ(0u, bbr::earliest_delivery_path(paths, 1000));
+
+    // Wi-Fi queues: 300KB in flight are 60ms, 40ms beyond its min rtt.
+    paths[0].bytes_inflight = 300000;
+    EXPECT_EQ(1u, bbr::earliest_delivery_path(paths, 1000));
+
+    // Lost on cellular, reinjected on Wi-Fi even though it queues.
+    EXPECT_EQ(0u, bbr::earliest_delivery_path(paths, 1000, 1));
+
+    // Cwnd full.
+    paths[0].can_send = false;
+    EXPECT_EQ(1u, bbr::earliest_delivery_path(paths, 1000));
+    paths[1].can_send = false;
+    EXPECT_EQ(static_cast<size_t>(-1), bbr::earliest_delivery_path(paths, 1000));
+}
@@ -0,0 +1,76 @@
+#ifndef BBR_PROBE_RTT_COORDINATOR_H_
+#define BBR_PROBE_RTT_COORDINATOR_H_
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <time/timestamp.h>
+
+namespace bbr
+{
+// Shared by the connections of one path (e.g. to the same destination) so
+// that they enter PROBE_RTT together: while one connection drains alone the
+// others keep the queue full, and nobody measures the real min rtt.
+// The first connection whose min_rtt expires starts a path wide PROBE_RTT,
+// the others join it on their next congestion event, see
+// BbrModel::path_probing_rtt(). The min rtt they measure is shared, a
+// connection whose min_rtt expires later takes it instead of probing again.
+// Thread safe. probe_rtt_start() (polled per congestion event) is a single
+// atomic load, the rest is called once per PROBE_RTT.
+class ProbeRttCoordinator
+{
+public:
+    // Starts a path wide PROBE_RTT at |now| unless one started less than
+    // |duration| ago, returns the start of the current one.
+    time::Timestamp start_probe_rtt(time::Timestamp now, time::TimeDelta duration) {
+        int64_t start = probe_rtt_start_us_.load(std::memory_order_acquire);
+        while (start == kNone || now.microseconds() - start >= duration.value()) {
+            if (probe_rtt_start_us_.compare_exchange_weak(start,
+                        now.microseconds(), std::memory_order_acq_rel)) {
+                return now;
+            }
+        }
+        return time::Timestamp(start);
+    }
+
+    // Invalid if no PROBE_RTT was started yet.
+    time::Timestamp probe_rtt_start() const {
+        int64_t start = probe_rtt_start_us_.load(std::memory_order_acquire);
+        return start == kNone ? time::Timestamp() : time::Timestamp(start);
+    }
+
+    // A connection left PROBE_RTT with |min_rtt|, measured at |at_time|.
+    // The lowest report of the latest PROBE_RTT is kept.
+    void report_min_rtt(time::TimeDelta min_rtt, time::Timestamp at_time) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        time::Timestamp start = probe_rtt_start();
+        bool same_probe = min_rtt_timestamp_.is_valid() && start.is_valid() &&
+                min_rtt_timestamp_ >= start;
+        if (!same_probe || min_rtt < min_rtt_) {
+            min_rtt_ = min_rtt;
+            min_rtt_timestamp_ = at_time;
+        }
+    }
+
+    // false if nothing was reported yet.
+    bool min_rtt(time::TimeDelta& min_rtt, time::Timestamp& at_time) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!min_rtt_timestamp_.is_valid()) {
+            return false;
+        }
+        min_rtt = min_rtt_;
+        at_time = min_rtt_timestamp_;
+        return true;
+    }
+
+private:
+    static constexpr int64_t kNone = time::Timestamp::kMinusInfinity;
+
+    std::atomic<int64_t> probe_rtt_start_us_{kNone};
+
+    mutable std::mutex mutex_;
+    time::TimeDelta min_rtt_;
+    time::Timestamp min_rtt_timestamp_;
+};
+}
+#endif
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <probe_rtt_coordinator.h>
+
+using ProbeRttCoordinator = bbr::ProbeRttCoordinator;
+using Timestamp = bbr::time::Timestamp;
+using TimeDelta = bbr::time::TimeDelta;
+using namespace bbr::time;
+
+TEST(ProbeRttCoordinatorTest, JoinsRunningProbe)
+{
+    ProbeRttCoordinator coordinator;
+    EXPECT_FALSE(coordinator.probe_rtt_start().is_valid());
+
+    EXPECT_EQ(Timestamp(1000), coordinator.start_probe_rtt(Timestamp(1000), 200_ms));
+    // Another connection expiring during the probe joins it.
+    EXPECT_EQ(Timestamp(1000), coordinator.start_probe_rtt(Timestamp(50000), 200_ms));
+    EXPECT_EQ(Timestamp(1000), coordinator.probe_rtt_start());
+
+    // Once it is over a new one starts.
+    EXPECT_EQ(Timestamp(201000), coordinator.start_probe_rtt(Timestamp(201000), 200_ms));
+    EXPECT_EQ(Timestamp(201000), coordinator.probe_rtt_start());
+}
+
+TEST(ProbeRttCoordinatorTest, KeepsLowestMinRttOfLatestProbe)
+{
+    ProbeRttCoordinator coordinator;
+    TimeDelta min_rtt;
+    Timestamp at;
+    EXPECT_FALSE(coordinator.min_rtt(min_rtt, at));
+
+    coordinator.start_probe_rtt(Timestamp(1000), 200_ms);
+    coordinator.report_min_rtt(20_ms, Timestamp(210000));
+    coordinator.report_min_rtt(30_ms, Timestamp(220000));
+    ASSERT_TRUE(coordinator.min_rtt(min_rtt, at));
+    EXPECT_EQ(20_ms, min_rtt);
+    EXPECT_EQ(Timestamp(210000), at);
+
+    // A later probe replaces it, even if higher: the path changed.
+    coordinator.start_probe_rtt(Timestamp(10000000), 200_ms);
+    coordinator.report_min_rtt(40_ms, Timestamp(10210000));
+    ASSERT_TRUE(coordinator.min_rtt(min_rtt, at));
+    EXPECT_EQ(40_ms, min_rtt);
+    EXPECT_EQ(Timestamp(10210000), at);
+}
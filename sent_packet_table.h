@@ -0,0 +1,278 @@
+#ifndef BBR_SENT_PACKET_TABLE_H_
+#define BBR_SENT_PACKET_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <bbr.h>
+#include <time/timestamp.h>
+
+namespace bbr
+{
+// BandwidthSampler's per packet state, packed into 32 bytes since one is kept
+// for every packet in flight. The size of the packet is not repeated here,
+// it is read from SentPacketTable::bytes().
+// Times are microsecond offsets from the sampler's epoch and byte counters are
+// the low 32 bits of the running totals, both are restored against the
+// sampler's current values, see BandwidthSampler::sent_time() and
+// BandwidthSampler::connection_state_to_sent_state().
+// That holds as long as a packet is tracked for less than ~35 minutes and
+// less than 4GB is sent/acked/lost while it is in flight.
+struct ConnectionStateOnSentPacket
+{
+    // Gaps which do not fit into 23 bits (~8.4s) are saturated to
+    // kInvalidTimeGap, no bandwidth sample is made from such a packet.
+    static constexpr uint32_t kInvalidTimeGap = (1u << 23) - 1;
+
+    uint64_t is_app_limited : 1;
+    // sent_time - last_acked_pkt_sent_time
+    uint64_t last_acked_pkt_sent_gap_us : 23;
+    // sent_time - last_acked_pkt_ack_time
+    uint64_t last_acked_pkt_ack_gap_us : 23;
+
+    uint32_t sent_time_us;
+    uint32_t total_bytes_sent;
+    uint32_t total_bytes_acked;
+    uint32_t total_bytes_lost;
+    uint32_t bytes_in_flight;
+    // state.total_bytes_sent - total_sent_bytes_at_last_acked_pkt
+    uint32_t bytes_sent_since_last_acked_pkt;
+};
+static_assert(sizeof(ConnectionStateOnSentPacket) == 32,
+        "ConnectionStateOnSentPacket should be kept in 32 bytes");
+
+// All tracked sent packets of a connection, shared by BbrSender (payloads),
+// LossDetect (sizes, send times) and BandwidthSampler (sampler states), so
+// that one ack needs one lookup.
+// Columns are kept in separate arrays (structure of arrays) indexed by
+// seq_no modulo the capacity, a component only touches the columns it reads.
+// The capacity (a power of two) grows to cover the range between the oldest
+// tracked and the newest inserted seq_no, memory is allocated on the first
+// insert. Once that range falls below a quarter of the capacity the table
+// shrinks back (not below kInitialCapacity), so a connection that was busy
+// does not keep its peak memory while idle.
+class SentPacketTable
+{
+    static constexpr size_t kInitialCapacity = 64;
+
+    enum Flags : uint8_t {
+        kOccupied = 1,
+        kHasSamplerState = 2,
+    };
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    // Owners give up packets more than kMaxSpan seq_no behind the newest one
+    // as lost, so that a loss detector missing some packets cannot grow the
+    // table without bound, see BasicBbrSender.
+    static constexpr uint64_t kMaxSpan = 1 << 16;
+
+    explicit SentPacketTable(bool track_payloads = false)
+        :track_payloads_(track_payloads)
+    {}
+
+    // Returns the slot of |seq_no|, which is inserted if not tracked yet.
+    // A slot is valid until the next insert.
+    size_t insert(uint64_t seq_no, size_t bytes, time::Timestamp sent_time) {
+        size_t slot = find(seq_no);
+        if (slot != npos) {
+            return slot;
+        }
+        if (count_ == 0) {
+            first_ = seq_no;
+            end_ = seq_no + 1;
+        }
+        uint64_t first = std::min(first_, seq_no);
+        uint64_t end = std::max(end_, seq_no + 1);
+        if (end - first > capacity()) {
+            resize(capacity_for(end - first));
+        }
+        first_ = first;
+        end_ = end;
+
+        slot = seq_no & mask_;
+        seq_nos_[slot] = seq_no;
+        flags_[slot] = kOccupied;
+        sizes_[slot] = static_cast<uint32_t>(bytes);
+        sent_times_[slot] = sent_time;
+        count_++;
+        return slot;
+    }
+
+    // npos if |seq_no| is not tracked.
+    size_t find(uint64_t seq_no) const {
+        if (count_ == 0 || seq_no < first_ || seq_no >= end_) {
+            return npos;
+        }
+        size_t slot = seq_no & mask_;
+        if (!(flags_[slot] & kOccupied) || seq_nos_[slot] != seq_no) {
+            return npos;
+        }
+        return slot;
+    }
+
+    void erase(uint64_t seq_no) {
+        size_t slot = find(seq_no);
+        if (slot == npos) {
+            return;
+        }
+        clear_slot(slot);
+        if (seq_no == first_) {
+            advance_first();
+            maybe_shrink();
+        }
+    }
+
+    //[0, up_to)
+    void erase_before(uint64_t up_to) {
+        while (count_ > 0 && first_ < up_to) {
+            clear_slot(first_ & mask_);
+            first_++;
+            advance_first();
+        }
+        maybe_shrink();
+    }
+
+    // Erases all packets, memory is kept up to kInitialCapacity.
+    void clear() {
+        erase_before(std::numeric_limits<uint64_t>::max());
+    }
+
+    // Frees all memory of an empty table, the next insert allocates again.
+    void release() {
+        if (count_ != 0) {
+            return;
+        }
+        std::vector<uint64_t>().swap(seq_nos_);
+        std::vector<uint8_t>().swap(flags_);
+        std::vector<uint32_t>().swap(sizes_);
+        std::vector<time::Timestamp>().swap(sent_times_);
+        std::vector<ConnectionStateOnSentPacket>().swap(sampler_states_);
+        std::vector<SendingPacket>().swap(payloads_);
+        mask_ = 0;
+    }
+
+    bool empty() const { return count_ == 0;}
+    // The oldest tracked seq_no, meaningless if empty.
+    uint64_t first() const { return first_;}
+    size_t size() const { return count_;}
+    size_t capacity() const { return seq_nos_.size();}
+
+    uint64_t seq_no(size_t slot) const { return seq_nos_[slot];}
+    size_t bytes(size_t slot) const { return sizes_[slot];}
+    time::Timestamp sent_time(size_t slot) const { return sent_times_[slot];}
+
+    bool has_sampler_state(size_t slot) const {
+        return flags_[slot] & kHasSamplerState;
+    }
+    const ConnectionStateOnSentPacket& sampler_state(size_t slot) const {
+        return sampler_states_[slot];
+    }
+    void set_sampler_state(size_t slot, const ConnectionStateOnSentPacket& state) {
+        sampler_states_[slot] = state;
+        flags_[slot] |= kHasSamplerState;
+    }
+
+    // Only available when constructed with |track_payloads|.
+    SendingPacket& payload(size_t slot) {
+        assert(track_payloads_);
+        return payloads_[slot];
+    }
+
+private:
+    void clear_slot(size_t slot) {
+        flags_[slot] = 0;
+        if (track_payloads_) {
+            payloads_[slot] = SendingPacket();
+        }
+        count_--;
+    }
+
+    // Skips erased slots so that |first_| is the oldest tracked seq_no.
+    void advance_first() {
+        if (count_ == 0) {
+            first_ = end_;
+            return;
+        }
+        while (!(flags_[first_ & mask_] & kOccupied)) {
+            first_++;
+        }
+    }
+
+    // The smallest power of two holding |span| seq_no.
+    static size_t capacity_for(uint64_t span) {
+        size_t capacity = kInitialCapacity;
+        while (capacity < span) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    // The range only shrinks from the front, by acks and losses. Halving at a
+    // quarter leaves room to grow twice before the next reallocation.
+    void maybe_shrink() {
+        if (capacity() <= kInitialCapacity) {
+            return;
+        }
+        uint64_t span = end_ - first_;
+        if (span * 4 <= capacity()) {
+            resize(capacity_for(span * 2));
+        }
+    }
+
+    void resize(size_t capacity) {
+        const size_t mask = capacity - 1;
+
+        std::vector<uint64_t> seq_nos(capacity);
+        std::vector<uint8_t> flags(capacity, 0);
+        std::vector<uint32_t> sizes(capacity);
+        std::vector<time::Timestamp> sent_times(capacity);
+        std::vector<ConnectionStateOnSentPacket> sampler_states(capacity);
+        std::vector<SendingPacket> payloads(track_payloads_ ? capacity : 0);
+
+        for (uint64_t seq_no = first_; count_ > 0 && seq_no < end_; seq_no++) {
+            size_t from = seq_no & mask_;
+            if (!(flags_[from] & kOccupied)) {
+                continue;
+            }
+            size_t to = seq_no & mask;
+            seq_nos[to] = seq_nos_[from];
+            flags[to] = flags_[from];
+            sizes[to] = sizes_[from];
+            sent_times[to] = sent_times_[from];
+            sampler_states[to] = sampler_states_[from];
+            if (track_payloads_) {
+                payloads[to] = std::move(payloads_[from]);
+            }
+        }
+
+        seq_nos_.swap(seq_nos);
+        flags_.swap(flags);
+        sizes_.swap(sizes);
+        sent_times_.swap(sent_times);
+        sampler_states_.swap(sampler_states);
+        payloads_.swap(payloads);
+        mask_ = mask;
+    }
+
+private:
+    const bool track_payloads_;
+
+    // Tracked seq_no are in [first_, end_).
+    uint64_t first_ = 0;
+    uint64_t end_ = 0;
+    size_t count_ = 0;
+    size_t mask_ = 0;
+
+    std::vector<uint64_t> seq_nos_;
+    std::vector<uint8_t> flags_;
+    std::vector<uint32_t> sizes_;
+    std::vector<time::Timestamp> sent_times_;
+    std::vector<ConnectionStateOnSentPacket> sampler_states_;
+    std::vector<SendingPacket> payloads_;
+};
+}
+#endif
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <sent_packet_table.h>
+
+using SentPacketTable = bbr::SentPacketTable;
+using Timestamp = bbr::time::Timestamp;
+
+TEST(SentPacketTableTest, InsertFindErase)
+{
+    SentPacketTable table;
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(0u, table.capacity());
+    EXPECT_EQ(SentPacketTable::npos, table.find(1));
+
+    for (uint64_t seq_no = 1; seq_no <= 10; seq_no++) {
+        table.insert(seq_no, 1000 + seq_no, Timestamp(seq_no * 1000));
+    }
+    EXPECT_EQ(10u, table.size());
+    // Inserting a tracked packet returns its slot.
+    EXPECT_EQ(table.find(5), table.insert(5, 1, Timestamp(0)));
+    EXPECT_EQ(1005u, table.bytes(table.find(5)));
+
+    size_t slot = table.find(3);
+    ASSERT_NE(SentPacketTable::npos, slot);
+    EXPECT_EQ(3u, table.seq_no(slot));
+    EXPECT_EQ(1003u, table.bytes(slot));
+    EXPECT_EQ(Timestamp(3000), table.sent_time(slot));
+    EXPECT_FALSE(table.has_sampler_state(slot));
+
+    table.erase(3);
+    EXPECT_EQ(SentPacketTable::npos, table.find(3));
+    EXPECT_EQ(9u, table.size());
+    EXPECT_EQ(SentPacketTable::npos, table.find(11));
+    EXPECT_EQ(SentPacketTable::npos, table.find(0));
+
+    table.erase_before(6);
+    EXPECT_EQ(5u, table.size());
+    EXPECT_EQ(SentPacketTable::npos, table.find(5));
+    EXPECT_NE(SentPacketTable::npos, table.find(6));
+    EXPECT_EQ(6u, table.first());
+
+    table.erase_before(100);
+    EXPECT_TRUE(table.empty());
+}
+
+TEST(SentPacketTableTest, GrowKeepsColumns)
+{
+    SentPacketTable table(true);
+    bbr::ConnectionStateOnSentPacket state{};
+    // Keep a window of 200 packets in flight while seq_no wraps the ring
+    // several times.
+    for (uint64_t seq_no = 1; seq_no <= 1000; seq_no++) {
+        size_t slot = table.insert(seq_no, seq_no % 1500, Timestamp(seq_no));
+        state.total_bytes_sent = static_cast<uint32_t>(seq_no);
+        table.set_sampler_state(slot, state);
+        table.payload(slot).seq_no = seq_no;
+        if (seq_no > 200) {
+            table.erase(seq_no - 200);
+        }
+    }
+    EXPECT_EQ(200u, table.size());
+    EXPECT_EQ(256u, table.capacity());
+    for (uint64_t seq_no = 801; seq_no <= 1000; seq_no++) {
+        size_t slot = table.find(seq_no);
+        ASSERT_NE(SentPacketTable::npos, slot);
+        EXPECT_EQ(seq_no % 1500, table.bytes(slot));
+        EXPECT_EQ(Timestamp(seq_no), table.sent_time(slot));
+        EXPECT_TRUE(table.has_sampler_state(slot));
+        EXPECT_EQ(seq_no, table.sampler_state(slot).total_bytes_sent);
+        EXPECT_EQ(seq_no, table.payload(slot).seq_no);
+    }
+    EXPECT_EQ(SentPacketTable::npos, table.find(800));
+}
+
+TEST(SentPacketTableTest, ShrinksWhenDrained)
+{
+    SentPacketTable table(true);
+    for (uint64_t seq_no = 1; seq_no <= 1000; seq_no++) {
+        table.insert(seq_no, 1200, Timestamp(seq_no));
+    }
+    EXPECT_EQ(1024u, table.capacity());
+
+    // Acked in order: the capacity follows the range still in flight.
+    for (uint64_t seq_no = 1; seq_no <= 900; seq_no++) {
+        table.erase(seq_no);
+        EXPECT_GE(table.capacity(), 1000 - seq_no);
+    }
+    EXPECT_EQ(100u, table.size());
+    EXPECT_EQ(256u, table.capacity());
+    for (uint64_t seq_no = 901; seq_no <= 1000; seq_no++) {
+        size_t slot = table.find(seq_no);
+        ASSERT_NE(SentPacketTable::npos, slot);
+        EXPECT_EQ(Timestamp(seq_no), table.sent_time(slot));
+    }
+
+    table.erase_before(1001);
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(64u, table.capacity());
+
+    // A hole at the front keeps the whole range.
+    for (uint64_t seq_no = 1001; seq_no <= 1500; seq_no++) {
+        table.insert(seq_no, 1200, Timestamp(seq_no));
+    }
+    for (uint64_t seq_no = 1002; seq_no <= 1500; seq_no++) {
+        table.erase(seq_no);
+    }
+    EXPECT_EQ(512u, table.capacity());
+    table.erase(1001);
+    EXPECT_EQ(64u, table.capacity());
+}
+
+TEST(SentPacketTableTest, Release)
+{
+    SentPacketTable table(true);
+    table.insert(1, 1200, Timestamp(1));
+    table.release();
+    EXPECT_EQ(64u, table.capacity());
+    EXPECT_NE(SentPacketTable::npos, table.find(1));
+
+    table.erase(1);
+    table.release();
+    EXPECT_EQ(0u, table.capacity());
+    EXPECT_EQ(SentPacketTable::npos, table.find(1));
+
+    size_t slot = table.insert(2, 1200, Timestamp(2));
+    EXPECT_EQ(64u, table.capacity());
+    table.payload(slot).seq_no = 2;
+    EXPECT_EQ(2u, table.seq_no(table.find(2)));
+}
@@ -0,0 +1,35 @@
+#ifndef BBR_TIME_CLOCK_H_
+#define BBR_TIME_CLOCK_H_
+
+#include <time/timestamp.h>
+#include <time/interval.h>
+
+namespace bbr
+{
+namespace time
+{
+// Clock policies of BasicBbrSender, anything with a 'Timestamp now()'.
+struct SystemClock
+{
+    Timestamp now() const { return Timestamp::now();}
+};
+
+// Only moves when told to, for simulations and tests.
+class SimulatedClock
+{
+public:
+    explicit SimulatedClock(Timestamp start = Timestamp(0))
+        :now_(start)
+    {}
+
+    Timestamp now() const { return now_;}
+
+    void advance(TimeDelta dt) { now_ += dt;}
+    void set(Timestamp now) { now_ = now;}
+
+private:
+    Timestamp now_;
+};
+}
+}
+#endif
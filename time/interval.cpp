@@ -34,32 +34,5 @@ std::string TimeDelta::to_str()const
     return std::string(buf) + unit;
 }
 
-//TODO: day and month?
-TimeDelta operator"" _hour(unsigned long long h)
-{
-    return TimeDelta(static_cast<int64_t>(h) * 60 * 60
-            * Timestamp::kMicroSecondsPerSecond);
-}
-TimeDelta operator"" _min(unsigned long long m)
-{
-    return TimeDelta(static_cast<int64_t>(m) *  60
-            * Timestamp::kMicroSecondsPerSecond);
-}
-TimeDelta operator"" _sec(unsigned long long s)
-{
-    return TimeDelta(static_cast<int64_t>(s)  
-            * Timestamp::kMicroSecondsPerSecond);
-}
-TimeDelta operator"" _ms(unsigned long long ms)
-{
-    return TimeDelta(static_cast<int64_t>(ms)  
-            * 1000);
-}
-TimeDelta operator"" _us(unsigned long long us)
-{ 
-    return TimeDelta( static_cast<int64_t>(us)  
-            * 1);
-}
-
 }
 }
@@ -16,57 +16,59 @@ namespace time
 class TimeDelta
 {
 public:
-     explicit TimeDelta(int64_t us = std::numeric_limits<std::int64_t>::max())
+    static constexpr int64_t kPlusInfinity = std::numeric_limits<std::int64_t>::max();
+    static constexpr int64_t kMinusInfinity = std::numeric_limits<std::int64_t>::min();
+
+    constexpr explicit TimeDelta(int64_t us = kPlusInfinity)
         :delta_us_(us)
     {}
-    int64_t value() const {
+    constexpr int64_t value() const {
         return delta_us_;
     }
-    bool is_valid()const 
-    { 
-        return value() != positive_infinity().value()
-            && value() != negative_infinity().value();
+    constexpr bool is_valid()const
+    {
+        return value() != kPlusInfinity && value() != kMinusInfinity;
     }
     std::string to_str()const;
-    static TimeDelta positive_infinity()
+    static constexpr TimeDelta positive_infinity()
     {
-        return TimeDelta(std::numeric_limits<std::int64_t>::max());
+        return TimeDelta(kPlusInfinity);
     }
-    static TimeDelta negative_infinity()
+    static constexpr TimeDelta negative_infinity()
     {
-        return TimeDelta(std::numeric_limits<std::int64_t>::min());
+        return TimeDelta(kMinusInfinity);
     }
 
 private:
     int64_t delta_us_;
 };
 
-inline bool operator < (const TimeDelta& t1,const TimeDelta& t2)
+inline constexpr bool operator < (const TimeDelta& t1,const TimeDelta& t2)
 {
     return t1.value() < t2.value();
 }
 
-inline bool operator <= (const TimeDelta& t1,const TimeDelta& t2)
+inline constexpr bool operator <= (const TimeDelta& t1,const TimeDelta& t2)
 {
     return t1.value() <= t2.value();
 }
 
-inline bool operator > (const TimeDelta& t1,const TimeDelta& t2)
+inline constexpr bool operator > (const TimeDelta& t1,const TimeDelta& t2)
 {
     return t1.value() > t2.value();
 }
 
-inline bool operator >= (const TimeDelta& t1,const TimeDelta& t2)
+inline constexpr bool operator >= (const TimeDelta& t1,const TimeDelta& t2)
 {
     return t1.value() >= t2.value();
 }
 
-inline bool operator == (const TimeDelta& t1,const TimeDelta& t2)
+inline constexpr bool operator == (const TimeDelta& t1,const TimeDelta& t2)
 {
     return t1.value() == t2.value();
 }
 
-inline bool operator != (const TimeDelta& t1,const TimeDelta& t2)
+inline constexpr bool operator != (const TimeDelta& t1,const TimeDelta& t2)
 {
     return !(t1.value() == t2.value());
 }
@@ -75,7 +77,7 @@ inline bool operator != (const TimeDelta& t1,const TimeDelta& t2)
  *加减乘除
  */
 template<typename T>
-inline TimeDelta operator + (const TimeDelta d1,const T d2)
+inline constexpr TimeDelta operator + (const TimeDelta d1,const T d2)
 {
     //不允许使用 1_ms + 1 这样的操作
     //正确使用格式为: 1_ms + 1_ms （两边都是TimeDelta类型)
@@ -84,14 +86,14 @@ inline TimeDelta operator + (const TimeDelta d1,const T d2)
 }
 
 template<typename T>
-inline TimeDelta operator - (const TimeDelta d1,const T d2)
+inline constexpr TimeDelta operator - (const TimeDelta d1,const T d2)
 {
     static_assert(!std::is_integral<T>::value,"1_ms - 1 is not allowed"); 
     return TimeDelta(d1.value() - d2.value());
 }
 
 template<typename T>
-inline TimeDelta operator * (const TimeDelta d1, const T d2)
+inline constexpr TimeDelta operator * (const TimeDelta d1, const T d2)
 {
     //不允许 3ms * 2us 等乱七八糟的操作
     //只可以 3ms * 2 = 6ms
@@ -102,13 +104,13 @@ inline TimeDelta operator * (const TimeDelta d1, const T d2)
 }
 
 template<typename T>
-inline TimeDelta operator * (const T d2, const TimeDelta d1)
+inline constexpr TimeDelta operator * (const T d2, const TimeDelta d1)
 {
     return d1 * d2;
 }
 
 template<typename T>
-inline TimeDelta operator / (const TimeDelta d1,const T d2)
+inline constexpr TimeDelta operator / (const TimeDelta d1,const T d2)
 {
     static_assert(std::is_integral<T>::value
             || std::is_floating_point<T>::value, "integral or float is required");
@@ -122,42 +124,75 @@ inline TimeDelta operator / (const TimeDelta d1,const T d2)
 //允许使用: 
 //      1ms / 1us = 1000;
 //      1ms / 3ms = 0.33333
-inline double operator / (const TimeDelta d1, const TimeDelta d2)
+inline constexpr double operator / (const TimeDelta d1, const TimeDelta d2)
 {
     return d1.value() * 1.0 / d2.value();
 }
 
-inline common::BitRate operator / (const size_t bytes, const time::TimeDelta dt)
+//以下三个运算在每个ack上都会用到, 用128位整数计算, 不经过double,
+//保证不同编译器/平台下结果一致
+//字节数 / 时间间隔 = 速度 (向零取整)
+inline constexpr common::BitRate operator / (const size_t bytes, const time::TimeDelta dt)
 {
-    using namespace time;
-    return common::BitRate(static_cast<int64_t>(bytes * 1.0 / dt.value() * 8 * 1000 * 1000));
+    if(dt.value() == 0) {
+        return common::BitRate::positive_infinity();
+    }
+    return common::BitRate(static_cast<int64_t>(
+            static_cast<__int128>(bytes) * 8 * 1000 * 1000 / dt.value()));
 }
 
-inline time::TimeDelta operator / (const size_t bytes, const common::BitRate bps)
+//字节数 / 速度 = 时间间隔 (四舍五入)
+inline constexpr time::TimeDelta operator / (const size_t bytes, const common::BitRate bps)
 {
-    using namespace time;
-    return time::TimeDelta(1*1000*1000) * (bytes * 1.0 / bps.value() * 8);
+    if(bps.value() <= 0) {
+        return time::TimeDelta::positive_infinity();
+    }
+    __int128 bits_us = static_cast<__int128>(bytes) * 8 * 1000 * 1000;
+    return time::TimeDelta(static_cast<int64_t>(
+            (bits_us + bps.value() / 2) / bps.value()));
 }
 
-//速度 * 时间间隔 = 比特数
-inline size_t operator * (const common::BitRate d1, const time::TimeDelta dt)
+//速度 * 时间间隔 = 比特数 (四舍五入)
+inline constexpr size_t operator * (const common::BitRate d1, const time::TimeDelta dt)
 {
-    using namespace time;
-    //return static_cast<size_t>(std::lround(d1.value() * (dt / 1_sec)));
-    return static_cast<size_t>(d1.value() * (dt / time::TimeDelta(1*1000*1000)) + 0.5);
+    __int128 bits = static_cast<__int128>(d1.value()) * dt.value();
+    if(bits <= 0) {
+        return 0;
+    }
+    bits = (bits + 500 * 1000) / (1000 * 1000);
+    if(bits > static_cast<__int128>(std::numeric_limits<size_t>::max())) {
+        return std::numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(bits);
 }
 
-inline size_t operator * (const time::TimeDelta dt, const common::BitRate d1)
+inline constexpr size_t operator * (const time::TimeDelta dt, const common::BitRate d1)
 {
     return d1 * dt;
 }
 
 //user-defined literals 
-TimeDelta operator"" _hour(unsigned long long h);
-TimeDelta operator"" _min(unsigned long long m);
-TimeDelta operator"" _sec(unsigned long long s);
-TimeDelta operator"" _ms(unsigned long long ms);
-TimeDelta operator"" _us(unsigned long long us);
+//TODO: day and month?
+inline constexpr TimeDelta operator"" _hour(unsigned long long h)
+{
+    return TimeDelta(static_cast<int64_t>(h) * 60 * 60 * 1000 * 1000);
+}
+inline constexpr TimeDelta operator"" _min(unsigned long long m)
+{
+    return TimeDelta(static_cast<int64_t>(m) * 60 * 1000 * 1000);
+}
+inline constexpr TimeDelta operator"" _sec(unsigned long long s)
+{
+    return TimeDelta(static_cast<int64_t>(s) * 1000 * 1000);
+}
+inline constexpr TimeDelta operator"" _ms(unsigned long long ms)
+{
+    return TimeDelta(static_cast<int64_t>(ms) * 1000);
+}
+inline constexpr TimeDelta operator"" _us(unsigned long long us)
+{
+    return TimeDelta(static_cast<int64_t>(us));
+}
 
 }
 }
@@ -45,16 +45,6 @@ Timestamp Timestamp::now(Type t)
     return Timestamp((static_cast<int64_t>(8) * 3600) * kMicroSecondsPerSecond + ::microseconds_since_epoch());
 }
 
-Timestamp Timestamp::positive_infinity()
-{
-    return Timestamp(std::numeric_limits<int64_t>::max());
-}
-
-Timestamp Timestamp::negative_infinity()
-{
-    return Timestamp(std::numeric_limits<int64_t>::min());
-}
-
 std::string Timestamp::to_str(bool show_microseconds)const
 {
     char buf[32] = {0};
@@ -2,6 +2,7 @@
 #define COMMON_TIME_STAMP_H_
 #include <string>
 #include <chrono>
+#include <limits>
 
 #include "interval.h"
 
@@ -17,26 +18,29 @@ public:
         kSinceEpoch = 1,
         kSincePowerup
     };
-    static const int kMicroSecondsPerSecond = 1000 * 1000;
-    static const int64_t kMicroSecondsPerDay = static_cast<int64_t>(kMicroSecondsPerSecond) * 24 * 60 * 60;
+    static constexpr int kMicroSecondsPerSecond = 1000 * 1000;
+    static constexpr int64_t kMicroSecondsPerDay = static_cast<int64_t>(kMicroSecondsPerSecond) * 24 * 60 * 60;
 
-    Timestamp()
-        :microseconds_(positive_infinity().microseconds())
+    static constexpr int64_t kPlusInfinity = std::numeric_limits<int64_t>::max();
+    static constexpr int64_t kMinusInfinity = std::numeric_limits<int64_t>::min();
+
+    constexpr Timestamp()
+        :microseconds_(kPlusInfinity)
     {}
-    Timestamp(int64_t time_)
+    constexpr Timestamp(int64_t time_)
         :microseconds_(time_)
     {}
-    inline bool is_valid() const{
-        return this->microseconds() != negative_infinity().microseconds() &&
-            this->microseconds() != positive_infinity().microseconds();
+    constexpr bool is_valid() const{
+        return this->microseconds() != kMinusInfinity &&
+            this->microseconds() != kPlusInfinity;
     }
 
-    inline int64_t microseconds() const
+    constexpr int64_t microseconds() const
     {
         return microseconds_;
     }
 
-    Timestamp& operator += (const TimeDelta dt)
+    constexpr Timestamp& operator += (const TimeDelta dt)
     {
         microseconds_ += dt.value();
         return *this;
@@ -45,53 +49,57 @@ public:
     std::string to_str(bool show_microseconds = true) const;
 
     static Timestamp now(Type since_power_up = kSincePowerup);
-    static Timestamp positive_infinity();
-    static Timestamp negative_infinity();
+    static constexpr Timestamp positive_infinity() {
+        return Timestamp(kPlusInfinity);
+    }
+    static constexpr Timestamp negative_infinity() {
+        return Timestamp(kMinusInfinity);
+    }
 
 private:
     int64_t microseconds_;
 };
 
-inline bool operator < (const Timestamp& a,const Timestamp& b)
+inline constexpr bool operator < (const Timestamp& a,const Timestamp& b)
 {
     return a.microseconds()< b.microseconds();
 }
 
-inline bool operator <= (const Timestamp& a,const Timestamp& b)
+inline constexpr bool operator <= (const Timestamp& a,const Timestamp& b)
 {
     return a.microseconds()<= b.microseconds();
 }
 
-inline bool operator > (const Timestamp& a,const Timestamp& b)
+inline constexpr bool operator > (const Timestamp& a,const Timestamp& b)
 {
     return b < a ;
 }
 
-inline bool operator >= (const Timestamp& a,const Timestamp& b)
+inline constexpr bool operator >= (const Timestamp& a,const Timestamp& b)
 {
     return b <= a ;
 }
 
-inline bool operator==(const Timestamp& lhs, const Timestamp& rhs)
+inline constexpr bool operator==(const Timestamp& lhs, const Timestamp& rhs)
 {
     return lhs.microseconds() == rhs.microseconds();
 }
-inline bool operator !=(const Timestamp& lhs, const Timestamp& rhs)
+inline constexpr bool operator !=(const Timestamp& lhs, const Timestamp& rhs)
 {
     return !(lhs.microseconds() == rhs.microseconds());
 }
 
-inline TimeDelta operator-(const Timestamp& lhs,const Timestamp& rhs)
+inline constexpr TimeDelta operator-(const Timestamp& lhs,const Timestamp& rhs)
 {
     return TimeDelta(lhs.microseconds() - rhs.microseconds());
 }
 
-inline Timestamp operator-(const Timestamp& lhs,const TimeDelta& dt)
+inline constexpr Timestamp operator-(const Timestamp& lhs,const TimeDelta& dt)
 {
     return Timestamp(lhs.microseconds() - dt.value());
 }
 
-inline int64_t operator + (const Timestamp& at_time,const TimeDelta dt)
+inline constexpr int64_t operator + (const Timestamp& at_time,const TimeDelta dt)
 {
     return at_time.microseconds() + dt.value();
 }